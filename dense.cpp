@@ -0,0 +1,582 @@
+#include "dense.h"
+
+#ifdef use_simd
+#include <immintrin.h>
+#endif
+
+
+SVMFLOAT dot_generic(const SVMFLOAT* x, const SVMFLOAT* y, const SVMINT n){
+  SVMFLOAT s0=0;
+  SVMFLOAT s1=0;
+  SVMFLOAT s2=0;
+  SVMFLOAT s3=0;
+  SVMINT i;
+  for(i=0;i+4<=n;i+=4){
+    s0 += x[i]*y[i];
+    s1 += x[i+1]*y[i+1];
+    s2 += x[i+2]*y[i+2];
+    s3 += x[i+3]*y[i+3];
+  };
+  for(;i<n;i++){
+    s0 += x[i]*y[i];
+  };
+  return((s0+s1)+(s2+s3));
+};
+
+
+SVMFLOAT dist2_generic(const SVMFLOAT* x, const SVMFLOAT* y, const SVMINT n){
+  SVMFLOAT s0=0;
+  SVMFLOAT s1=0;
+  SVMFLOAT d0;
+  SVMFLOAT d1;
+  SVMINT i;
+  for(i=0;i+2<=n;i+=2){
+    d0 = x[i]-y[i];
+    d1 = x[i+1]-y[i+1];
+    s0 += d0*d0;
+    s1 += d1*d1;
+  };
+  for(;i<n;i++){
+    d0 = x[i]-y[i];
+    s0 += d0*d0;
+  };
+  return(s0+s1);
+};
+
+
+void dot_rows_generic(const SVMFLOAT* x, const SVMFLOAT* rows, const SVMINT* which, const SVMINT count, const SVMINT n, SVMFLOAT* result){
+  SVMINT k;
+  for(k=0;k<count;k++){
+    result[k] = dot_generic(x,rows+which[k]*n,n);
+  };
+};
+
+
+void dist2_rows_generic(const SVMFLOAT* x, const SVMFLOAT* rows, const SVMINT* which, const SVMINT count, const SVMINT n, SVMFLOAT* result){
+  SVMINT k;
+  for(k=0;k<count;k++){
+    result[k] = dist2_generic(x,rows+which[k]*n,n);
+  };
+};
+
+
+// micro kernels of dense_gemm: c[i*ldc+j] = xr[i]*(column j of panel)
+// for i < mrv, j < nrv, added to c if add. The panel holds gemm_nr
+// entries for each of the kc attributes.
+typedef void (*gemm_micro)(const SVMINT kc, const SVMFLOAT* const* xr, const SVMFLOAT* panel, SVMFLOAT* c, const SVMINT ldc, const SVMINT mrv, const SVMINT nrv, const int add);
+
+
+static void store_tile(const SVMFLOAT* tile, SVMFLOAT* c, const SVMINT ldc, const SVMINT mrv, const SVMINT nrv, const int add){
+  SVMINT i;
+  SVMINT j;
+  for(i=0;i<mrv;i++){
+    for(j=0;j<nrv;j++){
+      if(add){
+	c[i*ldc+j] += tile[i*gemm_nr+j];
+      }
+      else{
+	c[i*ldc+j] = tile[i*gemm_nr+j];
+      };
+    };
+  };
+};
+
+
+static void gemm_micro_generic(const SVMINT kc, const SVMFLOAT* const* xr, const SVMFLOAT* panel, SVMFLOAT* c, const SVMINT ldc, const SVMINT mrv, const SVMINT nrv, const int add){
+  // 4 vectors
+  SVMFLOAT tile[4*gemm_nr];
+  SVMFLOAT a;
+  const SVMFLOAT* b;
+  SVMINT i;
+  SVMINT j;
+  SVMINT k;
+  for(i=0;i<4*gemm_nr;i++){
+    tile[i] = 0;
+  };
+  for(k=0;k<kc;k++){
+    b = panel+k*gemm_nr;
+    for(i=0;i<4;i++){
+      a = xr[i][k];
+      for(j=0;j<gemm_nr;j++){
+	tile[i*gemm_nr+j] += a*b[j];
+      };
+    };
+  };
+  store_tile(tile,c,ldc,mrv,nrv,add);
+};
+
+
+static void gemm_blocked(const SVMFLOAT* const* x, const SVMINT m, const SVMFLOAT* packed, const SVMINT count, const SVMINT n, SVMFLOAT* result, const SVMINT ldr, gemm_micro micro, const SVMINT mr){
+  // gemm_kc attributes of a panel stay in the L1 cache while they are
+  // used for all vectors
+  SVMINT panels = (count+gemm_nr-1)/gemm_nr;
+  const SVMFLOAT* xr[8]; // mr <= 8
+  SVMINT i0;
+  SVMINT i;
+  SVMINT j;
+  SVMINT k0;
+  SVMINT kc;
+  SVMINT p;
+  SVMINT mrv;
+  SVMINT nrv;
+  if(n <= 0){
+    for(i=0;i<m;i++){
+      for(j=0;j<count;j++){
+	result[i*ldr+j] = 0;
+      };
+    };
+  };
+  for(k0=0;k0<n;k0+=gemm_kc){
+    kc = n-k0;
+    if(kc > gemm_kc) kc = gemm_kc;
+    for(p=0;p<panels;p++){
+      nrv = count-p*gemm_nr;
+      if(nrv > gemm_nr) nrv = gemm_nr;
+      for(i0=0;i0<m;i0+=mr){
+	mrv = m-i0;
+	if(mrv > mr) mrv = mr;
+	for(i=0;i<mr;i++){
+	  // missing vectors repeat the last one, their results are dropped
+	  xr[i] = x[i0+((i < mrv) ? i : mrv-1)]+k0;
+	};
+	micro(kc,xr,packed+(p*n+k0)*gemm_nr,result+i0*ldr+p*gemm_nr,ldr,mrv,nrv,(k0 > 0));
+      };
+    };
+  };
+};
+
+
+SVMINT dense_pack_size(const SVMINT count, const SVMINT n){
+  return(((count+gemm_nr-1)/gemm_nr)*gemm_nr*n);
+};
+
+
+void dense_pack(const SVMFLOAT* rows, const SVMINT count, const SVMINT n, SVMFLOAT* packed){
+  SVMINT p;
+  SVMINT j;
+  SVMINT k;
+  SVMINT panels = (count+gemm_nr-1)/gemm_nr;
+  SVMFLOAT* panel;
+  const SVMFLOAT* row;
+  for(p=0;p<panels;p++){
+    panel = packed+p*n*gemm_nr;
+    for(j=0;j<gemm_nr;j++){
+      if(p*gemm_nr+j < count){
+	row = rows+(p*gemm_nr+j)*n;
+	for(k=0;k<n;k++){
+	  panel[k*gemm_nr+j] = row[k];
+	};
+      }
+      else{
+	for(k=0;k<n;k++){
+	  panel[k*gemm_nr+j] = 0;
+	};
+      };
+    };
+  };
+};
+
+
+void gemm_generic(const SVMFLOAT* const* x, const SVMINT m, const SVMFLOAT* packed, const SVMINT count, const SVMINT n, SVMFLOAT* result, const SVMINT ldr){
+  gemm_blocked(x,m,packed,count,n,result,ldr,gemm_micro_generic,4);
+};
+
+
+void exp_generic(SVMFLOAT* x, const SVMINT n){
+  SVMINT k;
+  for(k=0;k<n;k++){
+    x[k] = exp(x[k]);
+  };
+};
+
+
+#ifdef use_simd
+
+__attribute__((target("avx2,fma")))
+SVMFLOAT dot_avx2(const SVMFLOAT* x, const SVMFLOAT* y, const SVMINT n){
+  __m256d s0 = _mm256_setzero_pd();
+  __m256d s1 = _mm256_setzero_pd();
+  SVMINT i;
+  for(i=0;i+8<=n;i+=8){
+    s0 = _mm256_fmadd_pd(_mm256_loadu_pd(x+i),_mm256_loadu_pd(y+i),s0);
+    s1 = _mm256_fmadd_pd(_mm256_loadu_pd(x+i+4),_mm256_loadu_pd(y+i+4),s1);
+  };
+  s0 = _mm256_add_pd(s0,s1);
+  __m128d s = _mm_add_pd(_mm256_castpd256_pd128(s0),_mm256_extractf128_pd(s0,1));
+  SVMFLOAT result = _mm_cvtsd_f64(_mm_add_sd(s,_mm_unpackhi_pd(s,s)));
+  for(;i<n;i++){
+    result += x[i]*y[i];
+  };
+  return result;
+};
+
+
+__attribute__((target("avx2,fma")))
+SVMFLOAT dist2_avx2(const SVMFLOAT* x, const SVMFLOAT* y, const SVMINT n){
+  __m256d s0 = _mm256_setzero_pd();
+  __m256d s1 = _mm256_setzero_pd();
+  __m256d d0;
+  __m256d d1;
+  SVMINT i;
+  for(i=0;i+8<=n;i+=8){
+    d0 = _mm256_sub_pd(_mm256_loadu_pd(x+i),_mm256_loadu_pd(y+i));
+    d1 = _mm256_sub_pd(_mm256_loadu_pd(x+i+4),_mm256_loadu_pd(y+i+4));
+    s0 = _mm256_fmadd_pd(d0,d0,s0);
+    s1 = _mm256_fmadd_pd(d1,d1,s1);
+  };
+  s0 = _mm256_add_pd(s0,s1);
+  __m128d s = _mm_add_pd(_mm256_castpd256_pd128(s0),_mm256_extractf128_pd(s0,1));
+  SVMFLOAT result = _mm_cvtsd_f64(_mm_add_sd(s,_mm_unpackhi_pd(s,s)));
+  SVMFLOAT d;
+  for(;i<n;i++){
+    d = x[i]-y[i];
+    result += d*d;
+  };
+  return result;
+};
+
+
+__attribute__((target("avx512f")))
+SVMFLOAT dot_avx512(const SVMFLOAT* x, const SVMFLOAT* y, const SVMINT n){
+  __m512d s0 = _mm512_setzero_pd();
+  SVMINT i;
+  for(i=0;i+8<=n;i+=8){
+    s0 = _mm512_fmadd_pd(_mm512_loadu_pd(x+i),_mm512_loadu_pd(y+i),s0);
+  };
+  SVMFLOAT result = _mm512_reduce_add_pd(s0);
+  for(;i<n;i++){
+    result += x[i]*y[i];
+  };
+  return result;
+};
+
+
+__attribute__((target("avx512f")))
+SVMFLOAT dist2_avx512(const SVMFLOAT* x, const SVMFLOAT* y, const SVMINT n){
+  __m512d s0 = _mm512_setzero_pd();
+  __m512d d0;
+  SVMINT i;
+  for(i=0;i+8<=n;i+=8){
+    d0 = _mm512_sub_pd(_mm512_loadu_pd(x+i),_mm512_loadu_pd(y+i));
+    s0 = _mm512_fmadd_pd(d0,d0,s0);
+  };
+  SVMFLOAT result = _mm512_reduce_add_pd(s0);
+  SVMFLOAT d;
+  for(;i<n;i++){
+    d = x[i]-y[i];
+    result += d*d;
+  };
+  return result;
+};
+
+
+__attribute__((target("avx2,fma")))
+void dot_rows_avx2(const SVMFLOAT* x, const SVMFLOAT* rows, const SVMINT* which, const SVMINT count, const SVMINT n, SVMFLOAT* result){
+  SVMINT k;
+  for(k=0;k<count;k++){
+    result[k] = dot_avx2(x,rows+which[k]*n,n);
+  };
+};
+
+
+__attribute__((target("avx2,fma")))
+void dist2_rows_avx2(const SVMFLOAT* x, const SVMFLOAT* rows, const SVMINT* which, const SVMINT count, const SVMINT n, SVMFLOAT* result){
+  SVMINT k;
+  for(k=0;k<count;k++){
+    result[k] = dist2_avx2(x,rows+which[k]*n,n);
+  };
+};
+
+
+__attribute__((target("avx512f")))
+void dot_rows_avx512(const SVMFLOAT* x, const SVMFLOAT* rows, const SVMINT* which, const SVMINT count, const SVMINT n, SVMFLOAT* result){
+  SVMINT k;
+  for(k=0;k<count;k++){
+    result[k] = dot_avx512(x,rows+which[k]*n,n);
+  };
+};
+
+
+__attribute__((target("avx512f")))
+void dist2_rows_avx512(const SVMFLOAT* x, const SVMFLOAT* rows, const SVMINT* which, const SVMINT count, const SVMINT n, SVMFLOAT* result){
+  SVMINT k;
+  for(k=0;k<count;k++){
+    result[k] = dist2_avx512(x,rows+which[k]*n,n);
+  };
+};
+
+
+// exp(r) for |r| <= ln(2)/2 is 1+r+...+r^13/13!, exp(x) = 2^k*exp(x-k*ln(2))
+static const SVMFLOAT exp_coeff[14] = {
+  1.0, 1.0, 1.0/2, 1.0/6, 1.0/24, 1.0/120, 1.0/720, 1.0/5040,
+  1.0/40320, 1.0/362880, 1.0/3628800, 1.0/39916800, 1.0/479001600,
+  1.0/6227020800.0 };
+static const SVMFLOAT exp_log2e = 1.4426950408889634;
+static const SVMFLOAT exp_ln2_hi = 6.93145751953125e-1;
+static const SVMFLOAT exp_ln2_lo = 1.42860682030941723212e-6;
+// k+exp_round is k in the low bits of the mantissa
+static const SVMFLOAT exp_round = 6755399441055744.0;
+// outside, 2^k is no normal double, exp() is used
+static const SVMFLOAT exp_min = -708.0;
+static const SVMFLOAT exp_max = 709.0;
+
+
+__attribute__((target("avx2,fma")))
+static void gemm_micro_avx2(const SVMINT kc, const SVMFLOAT* const* xr, const SVMFLOAT* panel, SVMFLOAT* c, const SVMINT ldc, const SVMINT mrv, const SVMINT nrv, const int add){
+  // 3 vectors, 12 accumulators
+  __m256d c00 = _mm256_setzero_pd();
+  __m256d c01 = _mm256_setzero_pd();
+  __m256d c02 = _mm256_setzero_pd();
+  __m256d c03 = _mm256_setzero_pd();
+  __m256d c10 = _mm256_setzero_pd();
+  __m256d c11 = _mm256_setzero_pd();
+  __m256d c12 = _mm256_setzero_pd();
+  __m256d c13 = _mm256_setzero_pd();
+  __m256d c20 = _mm256_setzero_pd();
+  __m256d c21 = _mm256_setzero_pd();
+  __m256d c22 = _mm256_setzero_pd();
+  __m256d c23 = _mm256_setzero_pd();
+  __m256d a0;
+  __m256d a1;
+  __m256d a2;
+  __m256d b;
+  const SVMFLOAT* x0 = xr[0];
+  const SVMFLOAT* x1 = xr[1];
+  const SVMFLOAT* x2 = xr[2];
+  SVMINT k;
+  for(k=0;k<kc;k++){
+    a0 = _mm256_broadcast_sd(x0+k);
+    a1 = _mm256_broadcast_sd(x1+k);
+    a2 = _mm256_broadcast_sd(x2+k);
+    b = _mm256_load_pd(panel+k*gemm_nr);
+    c00 = _mm256_fmadd_pd(a0,b,c00);
+    c10 = _mm256_fmadd_pd(a1,b,c10);
+    c20 = _mm256_fmadd_pd(a2,b,c20);
+    b = _mm256_load_pd(panel+k*gemm_nr+4);
+    c01 = _mm256_fmadd_pd(a0,b,c01);
+    c11 = _mm256_fmadd_pd(a1,b,c11);
+    c21 = _mm256_fmadd_pd(a2,b,c21);
+    b = _mm256_load_pd(panel+k*gemm_nr+8);
+    c02 = _mm256_fmadd_pd(a0,b,c02);
+    c12 = _mm256_fmadd_pd(a1,b,c12);
+    c22 = _mm256_fmadd_pd(a2,b,c22);
+    b = _mm256_load_pd(panel+k*gemm_nr+12);
+    c03 = _mm256_fmadd_pd(a0,b,c03);
+    c13 = _mm256_fmadd_pd(a1,b,c13);
+    c23 = _mm256_fmadd_pd(a2,b,c23);
+  };
+  SVMFLOAT tile[3*gemm_nr];
+  _mm256_storeu_pd(tile,c00);
+  _mm256_storeu_pd(tile+4,c01);
+  _mm256_storeu_pd(tile+8,c02);
+  _mm256_storeu_pd(tile+12,c03);
+  _mm256_storeu_pd(tile+16,c10);
+  _mm256_storeu_pd(tile+20,c11);
+  _mm256_storeu_pd(tile+24,c12);
+  _mm256_storeu_pd(tile+28,c13);
+  _mm256_storeu_pd(tile+32,c20);
+  _mm256_storeu_pd(tile+36,c21);
+  _mm256_storeu_pd(tile+40,c22);
+  _mm256_storeu_pd(tile+44,c23);
+  store_tile(tile,c,ldc,mrv,nrv,add);
+};
+
+
+__attribute__((target("avx512f")))
+static void gemm_micro_avx512(const SVMINT kc, const SVMFLOAT* const* xr, const SVMFLOAT* panel, SVMFLOAT* c, const SVMINT ldc, const SVMINT mrv, const SVMINT nrv, const int add){
+  // 8 vectors, 16 accumulators
+  __m512d c00 = _mm512_setzero_pd();
+  __m512d c01 = _mm512_setzero_pd();
+  __m512d c10 = _mm512_setzero_pd();
+  __m512d c11 = _mm512_setzero_pd();
+  __m512d c20 = _mm512_setzero_pd();
+  __m512d c21 = _mm512_setzero_pd();
+  __m512d c30 = _mm512_setzero_pd();
+  __m512d c31 = _mm512_setzero_pd();
+  __m512d c40 = _mm512_setzero_pd();
+  __m512d c41 = _mm512_setzero_pd();
+  __m512d c50 = _mm512_setzero_pd();
+  __m512d c51 = _mm512_setzero_pd();
+  __m512d c60 = _mm512_setzero_pd();
+  __m512d c61 = _mm512_setzero_pd();
+  __m512d c70 = _mm512_setzero_pd();
+  __m512d c71 = _mm512_setzero_pd();
+  __m512d b0;
+  __m512d b1;
+  __m512d a;
+  SVMINT k;
+  for(k=0;k<kc;k++){
+    b0 = _mm512_load_pd(panel+k*gemm_nr);
+    b1 = _mm512_load_pd(panel+k*gemm_nr+8);
+    a = _mm512_set1_pd(xr[0][k]);
+    c00 = _mm512_fmadd_pd(a,b0,c00);
+    c01 = _mm512_fmadd_pd(a,b1,c01);
+    a = _mm512_set1_pd(xr[1][k]);
+    c10 = _mm512_fmadd_pd(a,b0,c10);
+    c11 = _mm512_fmadd_pd(a,b1,c11);
+    a = _mm512_set1_pd(xr[2][k]);
+    c20 = _mm512_fmadd_pd(a,b0,c20);
+    c21 = _mm512_fmadd_pd(a,b1,c21);
+    a = _mm512_set1_pd(xr[3][k]);
+    c30 = _mm512_fmadd_pd(a,b0,c30);
+    c31 = _mm512_fmadd_pd(a,b1,c31);
+    a = _mm512_set1_pd(xr[4][k]);
+    c40 = _mm512_fmadd_pd(a,b0,c40);
+    c41 = _mm512_fmadd_pd(a,b1,c41);
+    a = _mm512_set1_pd(xr[5][k]);
+    c50 = _mm512_fmadd_pd(a,b0,c50);
+    c51 = _mm512_fmadd_pd(a,b1,c51);
+    a = _mm512_set1_pd(xr[6][k]);
+    c60 = _mm512_fmadd_pd(a,b0,c60);
+    c61 = _mm512_fmadd_pd(a,b1,c61);
+    a = _mm512_set1_pd(xr[7][k]);
+    c70 = _mm512_fmadd_pd(a,b0,c70);
+    c71 = _mm512_fmadd_pd(a,b1,c71);
+  };
+  SVMFLOAT tile[8*gemm_nr];
+  _mm512_storeu_pd(tile,c00);
+  _mm512_storeu_pd(tile+8,c01);
+  _mm512_storeu_pd(tile+16,c10);
+  _mm512_storeu_pd(tile+24,c11);
+  _mm512_storeu_pd(tile+32,c20);
+  _mm512_storeu_pd(tile+40,c21);
+  _mm512_storeu_pd(tile+48,c30);
+  _mm512_storeu_pd(tile+56,c31);
+  _mm512_storeu_pd(tile+64,c40);
+  _mm512_storeu_pd(tile+72,c41);
+  _mm512_storeu_pd(tile+80,c50);
+  _mm512_storeu_pd(tile+88,c51);
+  _mm512_storeu_pd(tile+96,c60);
+  _mm512_storeu_pd(tile+104,c61);
+  _mm512_storeu_pd(tile+112,c70);
+  _mm512_storeu_pd(tile+120,c71);
+  store_tile(tile,c,ldc,mrv,nrv,add);
+};
+
+
+void gemm_avx2(const SVMFLOAT* const* x, const SVMINT m, const SVMFLOAT* packed, const SVMINT count, const SVMINT n, SVMFLOAT* result, const SVMINT ldr){
+  gemm_blocked(x,m,packed,count,n,result,ldr,gemm_micro_avx2,3);
+};
+
+
+void gemm_avx512(const SVMFLOAT* const* x, const SVMINT m, const SVMFLOAT* packed, const SVMINT count, const SVMINT n, SVMFLOAT* result, const SVMINT ldr){
+  gemm_blocked(x,m,packed,count,n,result,ldr,gemm_micro_avx512,8);
+};
+
+
+__attribute__((target("avx2,fma")))
+void exp_avx2(SVMFLOAT* x, const SVMINT n){
+  __m256d v;
+  __m256d k;
+  __m256d r;
+  __m256d p;
+  __m256i e;
+  SVMINT i;
+  SVMINT j;
+  for(i=0;i+4<=n;i+=4){
+    v = _mm256_loadu_pd(x+i);
+    if(0 != _mm256_movemask_pd(_mm256_or_pd(_mm256_cmp_pd(v,_mm256_set1_pd(exp_min),_CMP_LT_OQ),
+					    _mm256_cmp_pd(v,_mm256_set1_pd(exp_max),_CMP_NLE_UQ)))){
+      // very small, large or nan
+      for(j=i;j<i+4;j++){
+	x[j] = exp(x[j]);
+      };
+      continue;
+    };
+    r = _mm256_fmadd_pd(v,_mm256_set1_pd(exp_log2e),_mm256_set1_pd(exp_round));
+    e = _mm256_castpd_si256(r);
+    k = _mm256_sub_pd(r,_mm256_set1_pd(exp_round));
+    r = _mm256_fnmadd_pd(k,_mm256_set1_pd(exp_ln2_hi),v);
+    r = _mm256_fnmadd_pd(k,_mm256_set1_pd(exp_ln2_lo),r);
+    p = _mm256_set1_pd(exp_coeff[13]);
+    for(j=12;j>=0;j--){
+      p = _mm256_fmadd_pd(p,r,_mm256_set1_pd(exp_coeff[j]));
+    };
+    // 2^k from the low bits of e
+    e = _mm256_slli_epi64(_mm256_add_epi64(e,_mm256_set1_epi64x(1023)),52);
+    _mm256_storeu_pd(x+i,_mm256_mul_pd(p,_mm256_castsi256_pd(e)));
+  };
+  for(;i<n;i++){
+    x[i] = exp(x[i]);
+  };
+};
+
+
+__attribute__((target("avx512f")))
+void exp_avx512(SVMFLOAT* x, const SVMINT n){
+  __m512d v;
+  __m512d k;
+  __m512d r;
+  __m512d p;
+  __m512i e;
+  SVMINT i;
+  SVMINT j;
+  for(i=0;i+8<=n;i+=8){
+    v = _mm512_loadu_pd(x+i);
+    if(0 != (_mm512_cmp_pd_mask(v,_mm512_set1_pd(exp_min),_CMP_LT_OQ) |
+	     _mm512_cmp_pd_mask(v,_mm512_set1_pd(exp_max),_CMP_NLE_UQ))){
+      // very small, large or nan
+      for(j=i;j<i+8;j++){
+	x[j] = exp(x[j]);
+      };
+      continue;
+    };
+    r = _mm512_fmadd_pd(v,_mm512_set1_pd(exp_log2e),_mm512_set1_pd(exp_round));
+    e = _mm512_castpd_si512(r);
+    k = _mm512_sub_pd(r,_mm512_set1_pd(exp_round));
+    r = _mm512_fnmadd_pd(k,_mm512_set1_pd(exp_ln2_hi),v);
+    r = _mm512_fnmadd_pd(k,_mm512_set1_pd(exp_ln2_lo),r);
+    p = _mm512_set1_pd(exp_coeff[13]);
+    for(j=12;j>=0;j--){
+      p = _mm512_fmadd_pd(p,r,_mm512_set1_pd(exp_coeff[j]));
+    };
+    // 2^k from the low bits of e
+    e = _mm512_slli_epi64(_mm512_add_epi64(e,_mm512_set1_epi64(1023)),52);
+    _mm512_storeu_pd(x+i,_mm512_mul_pd(p,_mm512_castsi512_pd(e)));
+  };
+  for(;i<n;i++){
+    x[i] = exp(x[i]);
+  };
+};
+
+#endif
+
+
+SVMFLOAT (*dense_dot)(const SVMFLOAT* x, const SVMFLOAT* y, const SVMINT n) = dot_generic;
+SVMFLOAT (*dense_dist2)(const SVMFLOAT* x, const SVMFLOAT* y, const SVMINT n) = dist2_generic;
+void (*dense_dot_rows)(const SVMFLOAT* x, const SVMFLOAT* rows, const SVMINT* which, const SVMINT count, const SVMINT n, SVMFLOAT* result) = dot_rows_generic;
+void (*dense_dist2_rows)(const SVMFLOAT* x, const SVMFLOAT* rows, const SVMINT* which, const SVMINT count, const SVMINT n, SVMFLOAT* result) = dist2_rows_generic;
+void (*dense_gemm)(const SVMFLOAT* const* x, const SVMINT m, const SVMFLOAT* packed, const SVMINT count, const SVMINT n, SVMFLOAT* result, const SVMINT ldr) = gemm_generic;
+void (*dense_exp)(SVMFLOAT* x, const SVMINT n) = exp_generic;
+static const char* the_dense_version = "generic";
+
+
+void init_dense(){
+  // pick the versions for this cpu
+#ifdef use_simd
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("avx512f")){
+    dense_dot = dot_avx512;
+    dense_dist2 = dist2_avx512;
+    dense_dot_rows = dot_rows_avx512;
+    dense_dist2_rows = dist2_rows_avx512;
+    dense_gemm = gemm_avx512;
+    dense_exp = exp_avx512;
+    the_dense_version = "avx512";
+  }
+  else if(__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")){
+    dense_dot = dot_avx2;
+    dense_dist2 = dist2_avx2;
+    dense_dot_rows = dot_rows_avx2;
+    dense_dist2_rows = dist2_rows_avx2;
+    dense_gemm = gemm_avx2;
+    dense_exp = exp_avx2;
+    the_dense_version = "avx2";
+  };
+#endif
+};
+
+
+const char* dense_version(){
+  return the_dense_version;
+};
@@ -0,0 +1,58 @@
+#ifndef dense_h
+#define dense_h 1
+
+#include "globals.h"
+
+/**
+ * Vector operations on dense examples
+ *
+ * dense_dot and dense_dist2 point to the fastest version for this cpu
+ * (AVX-512, AVX2 or plain C++), init_dense() chooses it at runtime.
+ * The _rows versions do a whole kernel row in one call.
+ * dense_gemm() computes the products of many vectors with many rows as
+ * a cache blocked matrix product. The rows are packed once by
+ * dense_pack() into panels of gemm_nr rows stored attribute by
+ * attribute, a micro kernel computes the products of a panel with some
+ * vectors at once in registers. dense_exp() is a vectorized exp().
+ * Vectors should be padded with zeros to a multiple of dense_block
+ * entries and start at a multiple of 64 bytes.
+ *
+ * @author Stefan Rueping <rueping@ls8.cs.uni-dortmund.de>
+ * @version 0.1
+ **/
+
+
+// length of dense vectors is a multiple of this
+const SVMINT dense_block = 8;
+// rows per panel of dense_pack()
+const SVMINT gemm_nr = 16;
+// dense_gemm uses this many attributes of a panel at a time
+const SVMINT gemm_kc = 128;
+
+void init_dense();
+const char* dense_version(); // "avx512", "avx2" or "generic"
+
+// x*y of vectors of length n
+extern SVMFLOAT (*dense_dot)(const SVMFLOAT* x, const SVMFLOAT* y, const SVMINT n);
+
+// ||x-y||^2 of vectors of length n
+extern SVMFLOAT (*dense_dist2)(const SVMFLOAT* x, const SVMFLOAT* y, const SVMINT n);
+
+// result[k] = x*rows[which[k]] for k < count, row r starts at rows+r*n
+extern void (*dense_dot_rows)(const SVMFLOAT* x, const SVMFLOAT* rows, const SVMINT* which, const SVMINT count, const SVMINT n, SVMFLOAT* result);
+
+// result[k] = ||x-rows[which[k]]||^2 for k < count
+extern void (*dense_dist2_rows)(const SVMFLOAT* x, const SVMFLOAT* rows, const SVMINT* which, const SVMINT count, const SVMINT n, SVMFLOAT* result);
+
+// packed[(p*n+k)*gemm_nr+j] = rows[p*gemm_nr+j][k], zero for rows >= count
+SVMINT dense_pack_size(const SVMINT count, const SVMINT n); // length of packed
+void dense_pack(const SVMFLOAT* rows, const SVMINT count, const SVMINT n, SVMFLOAT* packed);
+
+// result[i*ldr+j] = x[i]*row j for i < m, j < count of rows packed by
+// dense_pack(), packed may point to any panel
+extern void (*dense_gemm)(const SVMFLOAT* const* x, const SVMINT m, const SVMFLOAT* packed, const SVMINT count, const SVMINT n, SVMFLOAT* result, const SVMINT ldr);
+
+// x[k] = exp(x[k]) for k < n
+extern void (*dense_exp)(SVMFLOAT* x, const SVMINT n);
+
+#endif
@@ -1,4 +1,32 @@
 #include "example_set.h"
+#include <fstream.h>
+#include <strstream.h>
+
+#ifdef use_threads
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#ifdef use_mmap
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+static SVMINT matrix_stride(const SVMINT n){
+  // n attributes padded to a multiple of example_align bytes
+  SVMINT per_align = example_align/sizeof(SVMFLOAT);
+  return ((n+per_align-1)/per_align)*per_align;
+};
+
+
+static SVMFLOAT* aligned_att(char* mem){
+  return (SVMFLOAT*)(mem+((example_align-((unsigned long)mem)%example_align)%example_align));
+};
+
 
 example_set_c::example_set_c(){
   init(0,0);
@@ -19,16 +47,26 @@ void example_set_c::init(SVMINT new_total, SVMINT new_dim){
   has_scale = 0;
   has_pattern_y = 1;
   b = 0;
-  all_alphas = 0;
-  all_ys = 0;
-  // create dummy
-  the_set = new svm_example[1];
-  the_set[0].example = 0;
+  start = 0;
+  length = 0;
+  att_mem = 0;
+  att = 0;
+  index = 0;
+  columns = 0;
+  cols = 0;
+  stride = 0;
+  atts_used = 0;
+  atts_capacity = 0;
+  ys = 0;
+  alphas = 0;
   dim=0;
   Exp = 0;
   Var = 0;
   filename = new char[MAXCHAR];
   filename[0]='\0';
+  file_mem = 0;
+  file_size = 0;
+  file_mapped = 0;
   set_dim(new_dim),
   resize(capacity);
   // set default file format
@@ -37,13 +75,13 @@ void example_set_c::init(SVMINT new_total, SVMINT new_dim){
   my_format.where_y = 1;
   my_format.where_alpha = 0;
   my_format.delimiter = ' ';
-}; 
+  my_format.binary = 0;
+};
 
 
 example_set_c::~example_set_c(){
   delete []filename;
   clear();
-  if(the_set) delete []the_set;
 };
 
 
@@ -56,39 +94,30 @@ void example_set_c::set_filename(char* new_filename){
   strcpy(filename,new_filename);
 };
 
- 
-void example_set_c::clear(){
-  if(all_alphas){
-    delete []all_alphas;
-    all_alphas=0;
-  };
-  if(all_ys){
-    delete []all_ys;
-    all_ys=0;
-  };
-  if(the_set){
-    SVMINT i;
-    SVMINT c;
-    for(i=0;i<capacity;i++){
-      if(the_set[i].example != 0){
-
-	for(c=0;c<the_set[i].length;c++){
-	  (((the_set[i]).example)[c]).index=28;
-	  (((the_set[i]).example)[c]).att = 4;
-	};
 
-	delete [](the_set[i].example); 
-	the_set[i].example=0;
-      };
-    };
-    delete []the_set;
-  };
+void example_set_c::clear(){
+  if(start) delete []start;
+  if(length) delete []length;
+  free_atts();
+  if(columns) delete []columns;
+  if(ys) delete []ys;
+  if(alphas) delete []alphas;
   if(Exp) delete []Exp;
   if(Var) delete []Var;
+  start = 0;
+  length = 0;
+  att_mem = 0;
+  att = 0;
+  index = 0;
+  columns = 0;
+  cols = 0;
+  stride = 0;
+  atts_used = 0;
+  atts_capacity = 0;
+  ys = 0;
+  alphas = 0;
   Exp = 0;
   Var = 0;
-  the_set = new svm_example[1];
-  the_set[0].example = 0;
   dim = 0;
   b = 0;
   examples_total = 0;
@@ -96,7 +125,7 @@ void example_set_c::clear(){
   has_y = 0;
   has_alphas = 0;
   has_scale = 0;
-};  
+};
 
 
 SVMINT example_set_c::size(){
@@ -108,7 +137,7 @@ SVMINT example_set_c::size_pos(){
   SVMINT i;
   SVMINT count=0;
   for(i=0;i<capacity;i++){
-    if(the_set[i].y > 0){
+    if((start[i] >= 0) && (ys[i] > 0)){
       count++;
     };
   };
@@ -120,7 +149,7 @@ SVMINT example_set_c::size_neg(){
   SVMINT i;
   SVMINT count=0;
   for(i=0;i<capacity;i++){
-    if(the_set[i].y < 0){
+    if((start[i] >= 0) && (ys[i] < 0)){
       count++;
     };
   };
@@ -131,7 +160,10 @@ SVMINT example_set_c::size_neg(){
 void example_set_c::set_dim(SVMINT new_dim){
   if(new_dim<dim){
     throw general_exception("ERROR: Trying to decrease dimension of examples");
-  };                                                                            
+  };
+  if(new_dim>MAXSVMINDEX){
+    throw general_exception("ERROR: Dimension of examples too large");
+  };
   dim = new_dim;
   if(Exp) delete []Exp;
   if(Var) delete []Var;
@@ -146,123 +178,208 @@ SVMINT example_set_c::get_dim(){
 
 
 void example_set_c::resize(SVMINT new_total){
-  svm_example* new_set = 0;
+  if(new_total == capacity) return;
+  SVMINT* new_start = new SVMINT[new_total];
+  SVMINT* new_length = new SVMINT[new_total];
+  SVMFLOAT* new_ys = new SVMFLOAT[new_total];
+  SVMFLOAT* new_alphas = new SVMFLOAT[new_total];
+  SVMINT keep = (new_total < capacity) ? new_total : capacity;
   SVMINT i;
-  if(new_total > capacity){
-    // add new space to set
-    new_set = new svm_example[new_total];
-    // copy old values
-    for(i=0;i<capacity;i++){
-      new_set[i] = the_set[i];
+  // copy old values
+  for(i=0;i<keep;i++){
+    new_start[i] = start[i];
+    new_length[i] = length[i];
+    new_ys[i] = ys[i];
+    new_alphas[i] = alphas[i];
+  };
+  for(i=keep;i<new_total;i++){
+    new_start[i] = -1;
+    new_length[i] = 0;
+    new_ys[i] = 0;
+    new_alphas[i] = 0;
+  };
+  // obsolete examples, their attributes stay unused until compress()
+  for(i=new_total;i<capacity;i++){
+    if(start[i] >= 0){
+      examples_total--;
     };
-    for(i=capacity;i<new_total;i++){
-      new_set[i].example = 0;
-      new_set[i].length = 0;
+  };
+  if(start) delete []start;
+  if(length) delete []length;
+  if(ys) delete []ys;
+  if(alphas) delete []alphas;
+  start = new_start;
+  length = new_length;
+  ys = new_ys;
+  alphas = new_alphas;
+  capacity = new_total;
+};
+
+
+SVMINT example_set_c::reserve_atts(const SVMINT new_atts){
+  if(atts_used+new_atts > atts_capacity){
+    // grow geometrically, so appending examples is linear
+    SVMINT new_capacity = 2*atts_capacity+1024;
+    if(new_capacity < atts_used+new_atts){
+      new_capacity = atts_used+new_atts;
     };
-    delete []the_set;
-    the_set=new_set;
-    capacity = new_total;
-    if(all_alphas != 0){
-      delete []all_alphas;
-      all_alphas = 0;
+    resize_atts(new_capacity);
+  };
+  SVMINT row = atts_used;
+  atts_used += new_atts;
+  return row;
+};
+
+
+void example_set_c::resize_atts(const SVMINT new_capacity){
+  // realloc() moves large blocks without copying, so the blocks never
+  // need twice their size while they grow. if the new block is aligned
+  // differently, the attributes move within it
+  own_atts();
+  SVMINT offset = (char*)att-att_mem;
+  char* new_mem = (char*)realloc(att_mem,(new_capacity+1)*sizeof(SVMFLOAT)+example_align);
+  if(0 != new_mem){
+    att_mem = new_mem;
+    att = aligned_att(att_mem);
+    if((char*)att-att_mem != offset){
+      memmove(att,att_mem+offset,atts_used*sizeof(SVMFLOAT));
     };
-    if(all_ys != 0){
-      delete []all_ys;
-      all_ys = 0;
+  };
+  svm_index* new_index = 0;
+  if(0 == columns){
+    new_index = (svm_index*)realloc(index,(new_capacity+1)*sizeof(svm_index));
+    if(0 != new_index) index = new_index;
+  };
+  if((0 == new_mem) || ((0 == columns) && (0 == new_index))){
+    throw general_exception("ERROR: Not enough memory for the examples");
+  };
+  atts_capacity = new_capacity;
+};
+
+
+void example_set_c::free_atts(){
+  if(0 != file_mem){
+    // att and index are part of the file
+#ifdef use_mmap
+    if(file_mapped){
+      munmap(file_mem,file_size);
+    }
+    else{
+      delete []file_mem;
     };
+#else
+    delete []file_mem;
+#endif
   }
-  else if(new_total < capacity){
-    new_set = new svm_example[new_total];
-    // copy remaining values
-    for(i=0;i<new_total;i++){
-      new_set[i] = the_set[i];
-    };
-    // delete obsolete values
-    for(i=new_total;i<capacity;i++){
-      if(the_set[i].example != 0){
-	delete [](the_set[i].example); 
-	the_set[i].example = 0;
-	examples_total--;
-      };
-    };
-    delete []the_set;
-    the_set=new_set;
-    capacity = new_total;
+  else{
+    if(att_mem) free(att_mem);
+    if(index) free(index);
+  };
+  file_mem = 0;
+  file_size = 0;
+  file_mapped = 0;
+  att_mem = 0;
+  att = 0;
+  index = 0;
+};
 
-    if(all_alphas != 0){
-      delete []all_alphas;
-      all_alphas = 0;
-    };
-    if(all_ys != 0){
-      delete []all_ys;
-      all_ys = 0;
-    };
+
+void example_set_c::own_atts(){
+  if(0 == file_mem) return;
+  char* new_mem = (char*)malloc((atts_capacity+1)*sizeof(SVMFLOAT)+example_align);
+  svm_index* new_index = 0;
+  if(0 == columns){
+    new_index = (svm_index*)malloc((atts_capacity+1)*sizeof(svm_index));
+  };
+  if((0 == new_mem) || ((0 == columns) && (0 == new_index))){
+    throw general_exception("ERROR: Not enough memory for the examples");
   };
+  SVMFLOAT* new_att = aligned_att(new_mem);
+  memcpy(new_att,att,atts_used*sizeof(SVMFLOAT));
+  if(0 == columns){
+    memcpy(new_index,index,atts_used*sizeof(svm_index));
+  };
+  free_atts();
+  att_mem = new_mem;
+  att = new_att;
+  index = new_index;
+};
+
+
+void example_set_c::set_row(const SVMINT pos, const SVMINT new_start, const SVMINT new_length){
+  if(start[pos] < 0){
+    // add new example
+    examples_total++;
+  };
+  start[pos] = new_start;
+  length[pos] = new_length;
 };
 
 
 void example_set_c::swap(SVMINT i, SVMINT j){
-  svm_example ex_dummy;
+  SVMINT int_dummy;
   SVMFLOAT dummy;
-  ex_dummy=the_set[i];
-  the_set[i] = the_set[j];
-  the_set[j] = ex_dummy;
-  if(all_alphas != 0){
-    dummy=all_alphas[i];
-    all_alphas[i] = all_alphas[j];
-    all_alphas[j] = dummy;
-  };
-  if(all_ys != 0){
-    dummy = all_ys[i];
-    all_ys[i] = all_ys[j];
-    all_ys[j] = dummy;
-  };
+  int_dummy = start[i];
+  start[i] = start[j];
+  start[j] = int_dummy;
+  int_dummy = length[i];
+  length[i] = length[j];
+  length[j] = int_dummy;
+  dummy = ys[i];
+  ys[i] = ys[j];
+  ys[j] = dummy;
+  dummy = alphas[i];
+  alphas[i] = alphas[j];
+  alphas[j] = dummy;
 };
 
 
 void example_set_c::put_example(const SVMINT pos, const SVMFLOAT* example){
   // examples is SVMFLOAT-array 1..dim
 
-  SVMINT non_zero=0;
-  svm_attrib* new_att;
-  SVMINT i;
-  for(i=0;i<dim;i++){
-    if(0 != example[i]){
-      non_zero++;
-    };
+  if((0 != columns) && 
+     ((cols != dim) || ((cols > 0) && (columns[cols-1] != cols-1)))){
+    // the matrix does not have all attributes
+    repack(0,0,0);
   };
   if(pos>=capacity){
     // make set bigger
-    resize(2*capacity+1);
+    resize((pos < 2*capacity+1) ? 2*capacity+1 : pos+1);
   };
-  if(0 == the_set[pos].example){
-    // add new example, reserve space for y and alpha
-    examples_total++;
+  SVMINT i;
+  SVMINT row;
+  if(0 != columns){
+    // example is a matrix row already
+    row = reserve_atts(stride);
+    for(i=0;i<dim;i++){
+      att[row+i] = example[i];
+    };
+    for(i=dim;i<stride;i++){
+      att[row+i] = 0;
+    };
+    set_row(pos,row,dim);
   }
   else{
-    delete [](the_set[pos].example);
-    the_set[pos].example = 0;
+    SVMINT non_zero=0;
+    for(i=0;i<dim;i++){
+      if(0 != example[i]){
+	non_zero++;
+      };
+    };
+    row = reserve_atts(non_zero);
+    // add attributes
+    SVMINT j=0;
+    for(i=0;i<non_zero;i++){
+      while(0 == example[j]) j++;
+      att[row+i] = example[j];
+      index[row+i] = j;
+      j++;
+    };
+    set_row(pos,row,non_zero);
   };
-  new_att = new svm_attrib[non_zero];
-  the_set[pos].example = new_att;
-  // add attributes
-  SVMINT j=0;
-  for(i=0;i<non_zero;i++){
-    while(0 == example[j]) j++;
-    new_att[i].att = example[j];
-    new_att[i].index=j;
-    j++;
-  };
-  the_set[pos].y = example[dim];
-  the_set[pos].alpha = example[dim+1];
-  the_set[pos].length = non_zero;
-  if(all_alphas != 0){
-    all_alphas[pos] = the_set[pos].alpha;
-  };
-  if(all_ys != 0){
-    all_ys[pos]=the_set[pos].y;
-  };
-  if((the_set[pos].y != 1) && (the_set[pos].y != -1)){
+  ys[pos] = example[dim];
+  alphas[pos] = example[dim+1];
+  if((ys[pos] != 1) && (ys[pos] != -1)){
     has_pattern_y = 0;
   };
 };
@@ -274,36 +391,66 @@ void example_set_c::put_example(const SVMFLOAT* example){
 
 
 void example_set_c::put_example(const SVMINT pos, const svm_example example){
+  svm_example x = example;
+  SVMINT i;
+  // example may be one of ours, find it again after reserve_atts()
+  SVMINT own = -1;
+  if((0 != att) && (x.att >= att) && (x.att < att+atts_capacity)){
+    own = x.att-att;
+  };
+  SVMFLOAT* copy_att = 0;
+  svm_index* copy_index = 0;
+  if(0 != columns){
+    int same = (x.length == cols);
+    for(i=0;same && (i<cols);i++){
+      if((x.index)[i] != columns[i]) same = 0;
+    };
+    if(! same){
+      // no matrix row, the blocks are replaced
+      if(own >= 0){
+	copy_att = new SVMFLOAT[x.length+1];
+	copy_index = new svm_index[x.length+1];
+	for(i=0;i<x.length;i++){
+	  copy_att[i] = (x.att)[i];
+	  copy_index[i] = (x.index)[i];
+	};
+	x.att = copy_att;
+	x.index = copy_index;
+	own = -1;
+      };
+      repack(0,0,0);
+    };
+  };
   if(pos>=capacity){
     // make set bigger
-    resize(2*capacity+1);
+    resize((pos < 2*capacity+1) ? 2*capacity+1 : pos+1);
+  };
+  SVMINT row = reserve_atts((0 != columns) ? stride : x.length);
+  SVMFLOAT* from_att = (own >= 0) ? att+own : x.att;
+  for(i=0;i<x.length;i++){
+    att[row+i] = from_att[i];
   };
-  if(the_set[pos].example != 0){
-    // overwrite old
-    delete [](the_set[pos].example);
-    the_set[pos].example = 0;
+  if(0 != columns){
+    for(i=x.length;i<stride;i++){
+      att[row+i] = 0;
+    };
   }
   else{
-    examples_total++;
-  };
-  the_set[pos].length = example.length;
-  svm_attrib* new_att = new svm_attrib[example.length];
-  SVMINT i;
-  for(i=0;i<example.length;i++){
-    new_att[i] = example.example[i];
-  };
-  the_set[pos].example = new_att;
-  the_set[pos].y = example.y;
-  the_set[pos].alpha = example.alpha;
-  if(all_alphas != 0){
-    all_alphas[pos] = the_set[pos].alpha;
-  };
-  if(all_ys != 0){
-    all_ys[pos] = the_set[pos].y;
+    svm_index* from_index = (own >= 0) ? index+own : x.index;
+    for(i=0;i<x.length;i++){
+      index[row+i] = from_index[i];
+    };
   };
-  if((the_set[pos].y != 1) && (the_set[pos].y != -1)){
+  set_row(pos,row,x.length);
+  ys[pos] = x.y;
+  alphas[pos] = x.alpha;
+  if((ys[pos] != 1) && (ys[pos] != -1)){
     has_pattern_y = 0;
   };
+  if(0 != copy_att){
+    delete []copy_att;
+    delete []copy_index;
+  };
 };
 
 
@@ -313,15 +460,32 @@ void example_set_c::put_example(const svm_example example){
 
 
 svm_example example_set_c::get_example(const SVMINT pos){
-  return the_set[pos];
+  svm_example x;
+  x.length = length[pos];
+  x.att = att+start[pos];
+  x.index = (0 != columns) ? columns : index+start[pos];
+  x.y = ys[pos];
+  x.alpha = alphas[pos];
+  return x;
 };
 
 
-void example_set_c::put_y(const SVMINT pos, const SVMFLOAT y){
-  the_set[pos].y = y;
-  if(all_ys != 0){
-    all_ys[pos] = y;
+SVMFLOAT* example_set_c::get_matrix(SVMINT& matrix_stride){
+  if((0 == columns) || (cols != dim) || 
+     ((cols > 0) && (columns[cols-1] != cols-1))){
+    return 0;
+  };
+  SVMINT pos;
+  for(pos=0;pos<capacity;pos++){
+    if(start[pos] != pos*stride) return 0;
   };
+  matrix_stride = stride;
+  return att;
+};
+
+
+void example_set_c::put_y(const SVMINT pos, const SVMFLOAT y){
+  ys[pos] = y;
   if((y != 1) && (y != -1)){
     has_pattern_y = 0;
   };
@@ -329,20 +493,17 @@ void example_set_c::put_y(const SVMINT pos, const SVMFLOAT y){
 
 
 SVMFLOAT example_set_c::get_y(const SVMINT pos){
-  return (the_set[pos].y);
+  return ys[pos];
 };
 
 
 void example_set_c::put_alpha(const SVMINT pos, const SVMFLOAT alpha){
-  the_set[pos].alpha = alpha;
-  if(all_alphas != 0){
-    all_alphas[pos] = alpha;
-  };
+  alphas[pos] = alpha;
 };
 
 
 SVMFLOAT example_set_c::get_alpha(const SVMINT pos){
-  return (the_set[pos].alpha);
+  return alphas[pos];
 };
 
 
@@ -357,59 +518,184 @@ SVMFLOAT example_set_c::get_b(){
 
 
 SVMFLOAT* example_set_c::get_alphas(){
-  if(0 == all_alphas){
-    SVMINT the_size = size();
-    all_alphas = new SVMFLOAT[the_size];
-    SVMINT i;
-    for(i=0; i<the_size; i++){
-      all_alphas[i] = get_alpha(i);
-    };
-  };
-  return all_alphas;
+  return alphas;
 };
 
 
 SVMFLOAT* example_set_c::get_ys(){
-  if(0 == all_ys){
-    SVMINT the_size = size();
-    all_ys = new SVMFLOAT[the_size];
-    SVMINT i;
-    for(i=0; i<the_size; i++){
-      all_ys[i] = get_y(i);
-    };
-  };
-  return all_ys;
+  return ys;
 };
 
 
 void example_set_c::compress(){
-  // remove zeros out of examples
+  // remove empty positions, the rows become contiguous and in order.
+  // examples that all have the same attributes become a matrix
   SVMINT next=0;
-  SVMINT i=0;
+  SVMINT used=0;
+  SVMINT first=-1;
+  int in_order=1;
+  int same=(0 == columns);
+  SVMINT i;
   for(i=0;i<capacity;i++){
-    if(the_set[i].example != 0){
-      the_set[next] = the_set[i];
-      if(next != i){
-	the_set[i].example = 0;
-	the_set[i].length = 0;
+    if(start[i] >= 0){
+      if(start[i] != used) in_order = 0;
+      used += row_size(i);
+      if(first < 0){
+	first = i;
+      }
+      else if(same){
+	same = ((length[i] == length[first]) &&
+		(0 == memcmp(index+start[i],index+start[first],length[i]*sizeof(svm_index))));
       };
+    };
+  };
+  svm_index* new_columns = 0;
+  if(same && (first >= 0) && (length[first] > 0)){
+    new_columns = new svm_index[length[first]+1];
+    for(i=0;i<length[first];i++){
+      new_columns[i] = index[start[first]+i];
+    };
+    repack(new_columns,length[first],0);
+  }
+  else if(! in_order){
+    if(0 != columns){
+      new_columns = new svm_index[cols+1];
+      for(i=0;i<cols;i++){
+	new_columns[i] = columns[i];
+      };
+    };
+    repack(new_columns,cols,0);
+  }
+  else{
+    // as appended by the reader, only give back the free space
+    atts_used = used;
+    if(used != atts_capacity) resize_atts(used);
+  };
+  // close the gaps, the rows are in order now
+  for(i=0;i<capacity;i++){
+    if(start[i] >= 0){
+      start[next] = start[i];
+      length[next] = length[i];
+      ys[next] = ys[i];
+      alphas[next] = alphas[i];
       next++;
     };
   };
+  for(i=next;i<capacity;i++){
+    start[i] = -1;
+    length[i] = 0;
+  };
   resize(next);
 };
 
 
+void example_set_c::repack(svm_index* new_columns, const SVMINT new_cols, const int drop_zeros){
+  SVMINT new_stride = matrix_stride(new_cols);
+  SVMINT size=0;
+  SVMINT pos;
+  SVMINT k;
+  svm_example x;
+  for(pos=0;pos<capacity;pos++){
+    if(start[pos] < 0) continue;
+    if(0 != new_columns){
+      size += new_stride;
+    }
+    else if(drop_zeros){
+      x = get_example(pos);
+      for(k=0;k<x.length;k++){
+	if(0 != (x.att)[k]) size++;
+      };
+    }
+    else{
+      size += length[pos];
+    };
+  };
+  char* new_mem = (char*)malloc((size+1)*sizeof(SVMFLOAT)+example_align);
+  svm_index* new_index = 0;
+  if(0 == new_columns){
+    new_index = (svm_index*)malloc((size+1)*sizeof(svm_index));
+  };
+  if((0 == new_mem) || ((0 == new_columns) && (0 == new_index))){
+    throw general_exception("ERROR: Not enough memory for the examples");
+  };
+  SVMFLOAT* new_att = aligned_att(new_mem);
+  SVMINT row=0;
+  SVMINT j;
+  for(pos=0;pos<capacity;pos++){
+    if(start[pos] < 0) continue;
+    x = get_example(pos);
+    start[pos] = row;
+    if(0 != new_columns){
+      // x has the attributes new_columns
+      for(k=0;k<x.length;k++){
+	new_att[row+k] = (x.att)[k];
+      };
+      for(k=x.length;k<new_stride;k++){
+	new_att[row+k] = 0;
+      };
+      row += new_stride;
+    }
+    else{
+      j=0;
+      for(k=0;k<x.length;k++){
+	if((! drop_zeros) || (0 != (x.att)[k])){
+	  new_att[row+j] = (x.att)[k];
+	  new_index[row+j] = (x.index)[k];
+	  j++;
+	};
+      };
+      length[pos] = j;
+      row += j;
+    };
+  };
+  free_atts();
+  if(columns) delete []columns;
+  att_mem = new_mem;
+  att = new_att;
+  index = new_index;
+  columns = new_columns;
+  cols = (0 != new_columns) ? new_cols : 0;
+  stride = (0 != new_columns) ? new_stride : 0;
+  atts_used = size;
+  atts_capacity = size;
+};
+
+
+void example_set_c::start_matrix(){
+  // dense input goes to the matrix as it is read
+  if((0 != examples_total) || (0 != columns) || (dim <= 0)) return;
+  svm_index* new_columns = new svm_index[dim+1];
+  SVMINT i;
+  for(i=0;i<dim;i++){
+    new_columns[i] = i;
+  };
+  repack(new_columns,dim,0);
+};
+
+
+void example_set_c::drop_zeros(){
+  // compressed rows need no padding and no zeros, but an index
+  if((0 == columns) || has_scale) return;
+  SVMINT used=0;
+  SVMINT pos;
+  SVMINT k;
+  for(pos=0;pos<capacity;pos++){
+    if(start[pos] < 0) continue;
+    for(k=start[pos];k<start[pos]+cols;k++){
+      if(0 != att[k]) used++;
+    };
+  };
+  if(used*(sizeof(SVMFLOAT)+sizeof(svm_index)) < examples_total*stride*sizeof(SVMFLOAT)){
+    repack(0,0,1);
+  };
+};
+
+
 void example_set_c::scale_alphas(const SVMFLOAT factor){
   // set alpha -> factor*alpha
   SVMINT i;
   for(i=0;i<capacity;i++){
-    put_alpha(i,factor*get_alpha(i));
-  };
-  if(all_alphas){
-    for(i=0;i<capacity;i++){
-      all_alphas[i] = get_alpha(i);
-    };
+    alphas[i] *= factor;
   };
 };
 
@@ -436,21 +722,25 @@ void example_set_c::scale(int scale_y){
 
   SVMINT i;
 
-  // calculate Exp and Var 
+  // calculate Exp and Var
   for(i=0;i<=dim;i++){
     Exp[i] = 0;
     Var[i] = 0;
   };
   SVMINT pos;
-  svm_attrib the_att;
+  SVMINT k;
+  SVMFLOAT the_att;
+  svm_example x;
   for(pos=0;pos<capacity;pos++){
-    for(i=0;i<the_set[pos].length;i++){
-      the_att = (the_set[pos].example)[i];
-      Exp[the_att.index] += the_att.att;
-      Var[the_att.index] += the_att.att*the_att.att;
+    if(start[pos] < 0) continue;
+    x = get_example(pos);
+    for(k=0;k<x.length;k++){
+      the_att = (x.att)[k];
+      Exp[(x.index)[k]] += the_att;
+      Var[(x.index)[k]] += the_att*the_att;
     };
-    Exp[dim] += the_set[pos].y;
-    Var[dim] += the_set[pos].y*the_set[pos].y;
+    Exp[dim] += ys[pos];
+    Var[dim] += ys[pos]*ys[pos];
   };
   for(i=0;i<=dim;i++){
     Exp[i] /= examples_total;
@@ -479,60 +769,129 @@ void example_set_c::do_scale(){
   SVMINT i;
   SVMINT j=0;
   SVMINT k;
-  //  SVMINT length;
   SVMINT nonzero=0;
   SVMINT pos;
   for(i=0;i<dim;i++){
     if(Var[i] != 0) nonzero++;
   };
+  // all examples get the same nonzero attributes, so they become a matrix
+  svm_index* new_columns = new svm_index[nonzero+1];
+  for(i=0;i<dim;i++){
+    if(Var[i] != 0){
+      new_columns[j] = i;
+      j++;
+    };
+  };
+  SVMINT new_stride = matrix_stride(nonzero);
+  // the rows are rewritten in place if no new row overwrites an old row
+  // that is not read yet, going forward if the rows shrink, backward if
+  // they grow, else into a new block. a mapped file is never rewritten
+  int forward=(0 == file_mem);
+  int backward=(0 == file_mem);
+  SVMINT row=0;
+  SVMINT old_end=0;
+  SVMINT max_length=0;
   for(pos=0;pos<capacity;pos++){
-    //    length = the_set[pos].length;
+    if(start[pos] < 0) continue;
+    if(start[pos] != old_end){
+      forward = 0;
+      backward = 0;
+    };
+    if(row < start[pos]) backward = 0;
+    old_end += row_size(pos);
+    row += new_stride;
+    if(row > old_end) forward = 0;
+    if(length[pos] > max_length) max_length = length[pos];
+  };
+  SVMINT new_size = row;
+  char* new_mem;
+  SVMFLOAT* new_att;
+  if(forward || backward){
+    if(new_size > atts_capacity) resize_atts(new_size);
+    new_mem = att_mem;
+    new_att = att;
+  }
+  else{
+    new_mem = (char*)malloc((new_size+1)*sizeof(SVMFLOAT)+example_align);
+    if(0 == new_mem){
+      throw general_exception("ERROR: Not enough memory for the examples");
+    };
+    new_att = aligned_att(new_mem);
+  };
+  // the old row, it may be overwritten
+  SVMFLOAT* x_att = new SVMFLOAT[max_length+1];
+  svm_index* x_index = new svm_index[max_length+1];
+  SVMINT x_length;
+  svm_example x;
+  SVMINT p;
+  int down = (backward && (! forward));
+  row = down ? new_size : 0;
+  for(p=0;p<capacity;p++){
+    pos = down ? capacity-1-p : p;
+    if(start[pos] < 0) continue;
+    if(down) row -= new_stride;
+    x = get_example(pos);
+    x_length = x.length;
+    for(k=0;k<x_length;k++){
+      x_att[k] = (x.att)[k];
+      x_index[k] = (x.index)[k];
+    };
 
     // put zeros into vector, they might be scaled, kick constant atts out
-    svm_attrib* new_example = new svm_attrib[nonzero];
     j = 0; // index in new vector
     k = 0; // index in old vector
     i=0;
     while((i<dim) && (j < nonzero)){
-      if((k < the_set[pos].length) && (((the_set[pos].example)[k]).index < i)){
+      if((k < x_length) && (x_index[k] < i)){
 	k++;
       };
       if(Var[i] != 0){
-	new_example[j].index = i;
-	if(((the_set[pos].example)[k]).index == i){
-	  new_example[j].att = ((the_set[pos].example)[k]).att;
+	if((k < x_length) && (x_index[k] == i)){
+	  new_att[row+j] = x_att[k];
 	}
 	else{
-	  new_example[j].att = 0;
+	  new_att[row+j] = 0;
 	};
 	j++;
       };
       i++;
     };
-    
-    //    length = nonzero;
-    the_set[pos].length = nonzero;
-    delete []the_set[pos].example;
-    the_set[pos].example = new_example;
-
-    for(i=0;i<the_set[pos].length;i++){
-      j = ((the_set[pos].example)[i]).index;
-      if(0 != Var[j]){
-	((the_set[pos].example)[i]).att = (((the_set[pos].example)[i]).att - Exp[j])/Var[j];
-      }
-      else{
-	// shouldn't happen!
-	((the_set[pos].example)[i]).att = 0; //  x - Exp = 0
-      };
+    for(j=nonzero;j<new_stride;j++){
+      new_att[row+j] = 0;
+    };
+
+    start[pos] = row;
+    length[pos] = nonzero;
+
+    for(j=0;j<nonzero;j++){
+      i = new_columns[j];
+      new_att[row+j] = (new_att[row+j] - Exp[i])/Var[i];
     };
     if(0 != Var[dim]){
-      the_set[pos].y = (the_set[pos].y-Exp[dim])/Var[dim];
+      ys[pos] = (ys[pos]-Exp[dim])/Var[dim];
     }
     else{
-      the_set[pos].y -= Exp[dim]; // don't know if to scale ys, so Exp could be 0 or y
+      ys[pos] -= Exp[dim]; // don't know if to scale ys, so Exp could be 0 or y
     };
-
+    if(! down) row += new_stride;
   };
+  delete []x_att;
+  delete []x_index;
+  if(new_mem != att_mem){
+    free_atts();
+    att_mem = new_mem;
+    att = new_att;
+    atts_capacity = new_size;
+  }
+  else if(index){
+    free(index);
+  };
+  if(columns) delete []columns;
+  index = 0;
+  columns = new_columns;
+  cols = nonzero;
+  stride = new_stride;
+  atts_used = new_size;
 
   has_scale = 1;
 };
@@ -580,6 +939,22 @@ void example_set_c::scale(SVMFLOAT *theconst, SVMFLOAT *thefactor,SVMINT scaledi
 };
 
 
+int example_set_c::scaled_by(SVMFLOAT *theconst, SVMFLOAT *thefactor, SVMINT scaledim){
+  if((! has_scale) || (0 == Exp) || (0 == Var) ||
+     (0 == theconst) || (0 == thefactor) || (scaledim > dim)){
+    return 0;
+  };
+  SVMINT i;
+  for(i=0;i<scaledim;i++){
+    if((Exp[i] != theconst[i]) || (Var[i] != thefactor[i])) return 0;
+  };
+  for(i=scaledim;i<dim;i++){
+    if((0 != Exp[i]) || (0 != Var[i])) return 0;
+  };
+  return((Exp[dim] == theconst[scaledim]) && (Var[dim] == thefactor[scaledim]));
+};
+
+
 SVMFLOAT example_set_c::unscale_y(const SVMFLOAT scaled_y){
   if((0 == Exp) || (0 == Var)){
     return scaled_y;
@@ -596,29 +971,12 @@ SVMFLOAT example_set_c::unscale_y(const SVMFLOAT scaled_y){
 void example_set_c::permute(){
   // permute the examples
   //  srand((unsigned int)time(0));
-  svm_example dummy;
   SVMINT swap_pos;
 
   SVMINT pos;
   for(pos=0;pos<capacity-1;pos++){
     swap_pos = (SVMINT)((SVMFLOAT)(pos+1)*rand()/(RAND_MAX+1.0));
-    dummy = the_set[swap_pos];
-    the_set[swap_pos] = the_set[pos];
-    the_set[pos] = dummy;
-  };
-  SVMINT i;
-  SVMINT the_size;
-  if(all_alphas != 0){
-    the_size = size();
-    for(i=0;i<the_size;i++){
-      all_alphas[i] = get_alpha(i);
-    };
-  };
-  if(all_ys != 0){
-    the_size = size();
-    for(i=0;i<the_size;i++){
-      all_ys[i] = get_y(i);
-    };
+    swap(swap_pos,pos);
   };
 };
 
@@ -626,12 +984,7 @@ void example_set_c::permute(){
 void example_set_c::clear_alpha(){
   SVMINT i;
   for(i=0;i<capacity;i++){
-    put_alpha(i,0);
-  };
-  if(all_alphas){
-    for(i=0;i<capacity;i++){
-      all_alphas[i] = 0;
-    };
+    alphas[i] = 0;
   };
 };
 
@@ -652,8 +1005,8 @@ void example_set_c::output_ys(ostream& data_stream) const{
   data_stream<<"# examples ys"<<endl;
   SVMINT i;
   for(i=0;i<examples_total;i++){
-    data_stream<<(the_set[i].y)<<endl;
-  };  
+    data_stream<<ys[i]<<endl;
+  };
 };
 
 
@@ -714,6 +1067,48 @@ void readnext(istream& i, char* s, const char delimiter){
 };
 
 
+// an attribute of a sparse line as it is read
+typedef struct read_attrib{
+  svm_index index;
+  SVMINT order; // position in the line
+  SVMFLOAT att;
+} READ_ATTRIB;
+
+
+static int compare_read_attrib(const void* a, const void* b){
+  const read_attrib* x = (const read_attrib*)a;
+  const read_attrib* y = (const read_attrib*)b;
+  if(x->index != y->index){
+    return (x->index < y->index) ? -1 : 1;
+  };
+  return (x->order < y->order) ? -1 : ((x->order > y->order) ? 1 : 0);
+};
+
+
+static SVMINT sort_attributes(read_attrib* atts, const SVMINT length, SVMFLOAT* att, svm_index* index){
+  // puts the non-zero attributes into att and index with ascending index
+  // and returns their number. of equal indices the last one counts
+  SVMINT k;
+  int sorted=1;
+  for(k=1;k<length;k++){
+    if(atts[k].index <= atts[k-1].index) sorted = 0;
+  };
+  if(! sorted){
+    qsort(atts,length,sizeof(read_attrib),compare_read_attrib);
+  };
+  SVMINT n=0;
+  for(k=0;k<length;k++){
+    if((k+1 < length) && (atts[k+1].index == atts[k].index)) continue;
+    if(0 != atts[k].att){
+      att[n] = atts[k].att;
+      index[n] = atts[k].index;
+      n++;
+    };
+  };
+  return n;
+};
+
+
 istream& operator>> (istream& data_stream, example_set_c& examples){
   // lower case, scale (y/n)
   char* s = new char[MAXCHAR]; // next item in the stream
@@ -730,6 +1125,14 @@ istream& operator>> (istream& data_stream, example_set_c& examples){
   SVMINT pos; // dummy for pos of attribute in example
   SVMINT dim = examples.get_dim();
   SVMFLOAT* new_example = new SVMFLOAT[dim+2]; // examples to be inserted
+  SVMINT example_dim = dim; // new_example is big enough for example_dim
+  // sparse lines are read into atts, as svm_example
+  SVMINT atts_capacity = 0;
+  read_attrib* atts = 0;
+  svm_example sparse_example;
+  sparse_example.length = 0;
+  sparse_example.att = 0;
+  sparse_example.index = 0;
 
   while((next != EOF) && ('@' != next) && (! data_stream.eof())){
     try{
@@ -758,12 +1161,11 @@ istream& operator>> (istream& data_stream, example_set_c& examples){
 	      ((next >= '0') && (next <= '9'))){
 	// read an example
 	pos = 0;
-	new_example[dim] = 0;
-	new_example[dim+1] = 0;
 	if(sparse){
-	  for(pos=0;pos<dim;pos++){
-	    new_example[pos] = 0;
-	  };
+	  // only the given attributes, the length of the line counts, not dim
+	  sparse_example.length = 0;
+	  sparse_example.y = 0;
+	  sparse_example.alpha = 0;
 	  while((! data_stream.eof()) && ('\n' != data_stream.peek())){
 	    readnext(data_stream,s,delimiter);
 	    SVMINT spos = 0;
@@ -773,7 +1175,7 @@ istream& operator>> (istream& data_stream, example_set_c& examples){
 	    if(s[spos] == '\0'){
 	      // read y
 	      try{
-		new_example[dim] = string2svmfloat(s);
+		sparse_example.y = string2svmfloat(s);
 	      }
 	      catch(...){
 		throw read_exception("Class is no number - could not read example");
@@ -785,7 +1187,7 @@ istream& operator>> (istream& data_stream, example_set_c& examples){
 		// read alpha
 		strncpy(s2,s+spos+1,MAXCHAR-spos);
 		try{
-		  new_example[dim+1] = string2svmfloat(s2);
+		  sparse_example.alpha = string2svmfloat(s2);
 		}
 		catch(...){
 		  throw read_exception("Alpha is no number - could not read example");
@@ -796,7 +1198,7 @@ istream& operator>> (istream& data_stream, example_set_c& examples){
 		// read y
 		strncpy(s2,s+spos+1,MAXCHAR-spos);
 		try{
-		  new_example[dim] = string2svmfloat(s2);
+		  sparse_example.y = string2svmfloat(s2);
 		}
 		catch(...){
 		  throw read_exception("Class is no number - could not read example");
@@ -812,21 +1214,25 @@ istream& operator>> (istream& data_stream, example_set_c& examples){
 		if(pos>dim){
 		  // raise dimension
 		  examples.set_dim(pos);  
-		  SVMFLOAT* example_dummy = new SVMFLOAT[pos+2];
-		  example_dummy[pos] = new_example[dim];
-		  example_dummy[pos+1] = new_example[dim+1];
-		  for(i=0;i<dim;i++){
-		    example_dummy[i] = new_example[i];
-		  };
-		  for(i=dim;i<pos;i++){
-		    example_dummy[i] = 0;
-		  };
 		  dim = pos;
-		  delete []new_example;
-		  new_example = example_dummy;
 		};
+		if(sparse_example.length == atts_capacity){
+		  atts_capacity = 2*atts_capacity+64;
+		  read_attrib* atts_dummy = new read_attrib[atts_capacity];
+		  for(i=0;i<sparse_example.length;i++){
+		    atts_dummy[i] = atts[i];
+		  };
+		  if(atts) delete []atts;
+		  atts = atts_dummy;
+		  if(sparse_example.att) delete [](sparse_example.att);
+		  if(sparse_example.index) delete [](sparse_example.index);
+		  sparse_example.att = new SVMFLOAT[atts_capacity];
+		  sparse_example.index = new svm_index[atts_capacity];
+		};
+		atts[sparse_example.length].index = pos-1;
+		atts[sparse_example.length].order = sparse_example.length;
 		try{
-		  new_example[pos-1] = string2svmfloat(s+spos+1);
+		  atts[sparse_example.length].att = string2svmfloat(s+spos+1);
 		}
 		catch(...){
 		  char* t = new char[MAXCHAR];
@@ -834,6 +1240,7 @@ istream& operator>> (istream& data_stream, example_set_c& examples){
 		  t = strcat(t,s);
 		  throw read_exception(t);
 		}; 
+		sparse_example.length++;
 	      };
 	    };
 	    while((! data_stream.eof()) && 
@@ -842,10 +1249,20 @@ istream& operator>> (istream& data_stream, example_set_c& examples){
 	      data_stream.get();
 	    };
 	  };
+	  sparse_example.length = sort_attributes(atts,sparse_example.length,
+						  sparse_example.att,sparse_example.index);
 	  pos = dim; // mark as ok
 	}
 	else{
 	  // not sparse
+	  if(example_dim < dim){
+	    // dimension was raised by sparse lines
+	    delete []new_example;
+	    new_example = new SVMFLOAT[dim+2];
+	    example_dim = dim;
+	  };
+	  new_example[dim] = 0;
+	  new_example[dim+1] = 0;
 	  for(int i=1;i<=3;i++) {
 	    if(i ==  where_x){
 	      // read attributes
@@ -936,6 +1353,7 @@ istream& operator>> (istream& data_stream, example_set_c& examples){
 		new_example[pos+1] = dummy[dim+1];
 		delete []dummy;
 		dim = pos;
+		example_dim = dim;
 		examples.set_dim(dim);
 		i=4;
 	      }
@@ -991,7 +1409,13 @@ istream& operator>> (istream& data_stream, example_set_c& examples){
 	// insert examples, if ok.
 	if(pos==dim){
 	  // example ok, insert
-	  examples.put_example(new_example);
+	  if(sparse){
+	    examples.put_example(sparse_example);
+	  }
+	  else{
+	    examples.start_matrix();
+	    examples.put_example(new_example);
+	  };
 	  count++;
 	};
       }
@@ -1006,12 +1430,12 @@ istream& operator>> (istream& data_stream, example_set_c& examples){
 	  dim = new_dim;
 	  if(new_example != 0){ delete []new_example; };
 	  new_example = new SVMFLOAT[dim+2];
+	  example_dim = dim;
 	}
 	else if(0 == strcmp("number",s)){
 	  // number of examples, check later for consistency
 	  data_stream >> given_total;
 	  if(given_total > 0){
-	    // (examples.the_set).reserve((examples.the_set).size() + given_total);
 	    examples.resize(examples.size()+given_total);
 	  };
 	}
@@ -1087,14 +1511,24 @@ istream& operator>> (istream& data_stream, example_set_c& examples){
     catch(general_exception g){
       // re-throw own exceptions
       if(new_example) delete []new_example;
+      if(atts) delete []atts;
+      if(sparse_example.att) delete [](sparse_example.att);
+      if(sparse_example.index) delete [](sparse_example.index);
       throw g;
     }
     catch(...){
       if(new_example) delete []new_example;
+      if(atts) delete []atts;
+      if(sparse_example.att) delete [](sparse_example.att);
+      if(sparse_example.index) delete [](sparse_example.index);
       throw read_exception("Error while reading from stream");
     };
   };
   if(new_example) delete []new_example;
+  if(atts) delete []atts;
+  if(sparse_example.att) delete [](sparse_example.att);
+  if(sparse_example.index) delete [](sparse_example.index);
+  examples.drop_zeros();
   examples.compress();
 
   // check for consistency
@@ -1109,6 +1543,10 @@ istream& operator>> (istream& data_stream, example_set_c& examples){
 
 
 ostream& operator<< (ostream& data_stream, example_set_c& examples){
+  if(examples.my_format.binary){
+    examples.write_binary(data_stream);
+    return data_stream;
+  };
   // output examples
   data_stream << "# svm example set" << endl;
   data_stream << "dimension "<< examples.dim << endl;
@@ -1133,22 +1571,22 @@ ostream& operator<< (ostream& data_stream, example_set_c& examples){
       if((examples.Exp != 0) && (examples.Var != 0)){
 	for(pos=0;pos<the_example.length-1;pos++){
 	  // output x_j
-	  j = the_example.example[pos].index;
-	  data_stream<<(the_example.example[pos].index+1)<<":";
+	  j = the_example.index[pos];
+	  data_stream<<(the_example.index[pos]+1)<<":";
 	  if(0 != examples.Var[j]){
-	    data_stream<<(the_example.example[pos].att*examples.Var[j]+examples.Exp[j]);
+	    data_stream<<(the_example.att[pos]*examples.Var[j]+examples.Exp[j]);
 	  }
 	  else{
-	    data_stream<<the_example.example[pos].att+examples.Exp[j];
+	    data_stream<<the_example.att[pos]+examples.Exp[j];
 	  };
 	  data_stream<<delimiter;
 	}
-	data_stream<<(the_example.example[the_example.length-1].index+1)<<":";
+	data_stream<<(the_example.index[the_example.length-1]+1)<<":";
 	if(0 != examples.Var[dim-1]){
-	    data_stream<<(the_example.example[the_example.length-1].att*examples.Var[dim-1]+examples.Exp[dim-1]);
+	    data_stream<<(the_example.att[the_example.length-1]*examples.Var[dim-1]+examples.Exp[dim-1]);
 	}
 	else{
-	  data_stream<<the_example.example[the_example.length-1].att+examples.Exp[dim-1];
+	  data_stream<<the_example.att[the_example.length-1]+examples.Exp[dim-1];
 	};
 	if(examples.has_y){
 	  if(0 != examples.Var[dim]){
@@ -1161,11 +1599,11 @@ ostream& operator<< (ostream& data_stream, example_set_c& examples){
       }
       else{
 	for(pos=0;pos<the_example.length-1;pos++){
-	  data_stream<<(the_example.example[pos].index+1)<<":"
-		     <<(the_example.example[pos].att)<<delimiter;
+	  data_stream<<(the_example.index[pos]+1)<<":"
+		     <<(the_example.att[pos])<<delimiter;
 	};
-	data_stream<<(the_example.example[the_example.length-1].index+1)<<":"
-		   <<(the_example.example[the_example.length-1].att);
+	data_stream<<(the_example.index[the_example.length-1]+1)<<":"
+		   <<(the_example.att[the_example.length-1]);
 	if(examples.has_y){
 	  data_stream << delimiter << "y:" << examples.get_y(i);
 	};
@@ -1205,18 +1643,18 @@ ostream& operator<< (ostream& data_stream, example_set_c& examples){
 	  for(j=0;j<dim;j++){
 	    // output attribute j
 	    if(j != 0) data_stream<<delimiter;
-	    if((pos<the_example.length) && (the_example.example[pos].index == j)){
-	      // output the_example.example[pos].att
+	    if((pos<the_example.length) && (the_example.index[pos] == j)){
+	      // output the_example.att[pos]
 	      if((examples.Exp != 0) && (examples.Var != 0)){
 		if(0 != examples.Var[j]){
-		  data_stream<<(the_example.example[pos].att*examples.Var[j]+examples.Exp[j]);
+		  data_stream<<(the_example.att[pos]*examples.Var[j]+examples.Exp[j]);
 		}
 		else{
-		  data_stream<<the_example.example[pos].att+examples.Exp[j];
+		  data_stream<<the_example.att[pos]+examples.Exp[j];
 		};
 	      }
 	      else{
-		data_stream<<the_example.example[pos].att;
+		data_stream<<the_example.att[pos];
 	      };
 	      if(pos<the_example.length-1) pos++;
 	    }
@@ -1249,3 +1687,1059 @@ ostream& operator<< (ostream& data_stream, example_set_c& examples){
   };
   return data_stream;
 };
+
+
+static void write_padding(ostream& data_stream, const SVMINT length){
+  // zeros from length up to the next multiple of example_align
+  static const char zeros[example_align] = {0};
+  if(length % example_align != 0){
+    data_stream.write(zeros,example_align-length%example_align);
+  };
+};
+
+
+static SVMINT padded_length(const SVMINT length){
+  return ((length+example_align-1)/example_align)*example_align;
+};
+
+
+void example_set_c::write_binary(ostream& data_stream){
+  // the examples as they are stored (scaled, if they are), the arrays are
+  // aligned relative to the position of data_stream
+  SVMINT total = examples_total;
+  SVMINT i;
+  svm_example x;
+  example_header header;
+  memset(&header,0,sizeof(header));
+  memcpy(header.magic,example_magic,8);
+  header.version = example_version;
+  header.size_int = sizeof(SVMINT);
+  header.size_float = sizeof(SVMFLOAT);
+  header.size_index = sizeof(svm_index);
+  header.count = total;
+  header.dim = dim;
+  header.cols = (0 != columns) ? cols : -1;
+  header.stride = (0 != columns) ? stride : 0;
+  header.atts = 0;
+  for(i=0;i<total;i++){
+    header.atts += (0 != columns) ? stride : get_example(i).length;
+  };
+  header.sparse = my_format.sparse;
+  header.where_x = my_format.where_x;
+  header.where_y = my_format.where_y;
+  header.where_alpha = my_format.where_alpha;
+  header.delimiter = my_format.delimiter;
+  header.has_y = has_y;
+  header.has_alphas = has_alphas;
+  header.has_scale = (has_scale && (0 != Exp) && (0 != Var));
+  header.has_pattern_y = has_pattern_y;
+  header.b = b;
+
+  data_stream.write((const char*)&header,sizeof(header));
+  write_padding(data_stream,sizeof(header));
+  if(header.has_scale){
+    data_stream.write((const char*)Exp,(dim+1)*sizeof(SVMFLOAT));
+    write_padding(data_stream,(dim+1)*sizeof(SVMFLOAT));
+    data_stream.write((const char*)Var,(dim+1)*sizeof(SVMFLOAT));
+    write_padding(data_stream,(dim+1)*sizeof(SVMFLOAT));
+  };
+  data_stream.write((const char*)ys,total*sizeof(SVMFLOAT));
+  write_padding(data_stream,total*sizeof(SVMFLOAT));
+  data_stream.write((const char*)alphas,total*sizeof(SVMFLOAT));
+  write_padding(data_stream,total*sizeof(SVMFLOAT));
+  SVMINT row=0;
+  for(i=0;i<=total;i++){
+    data_stream.write((const char*)&row,sizeof(SVMINT));
+    if(i < total){
+      row += (0 != columns) ? stride : get_example(i).length;
+    };
+  };
+  write_padding(data_stream,(total+1)*sizeof(SVMINT));
+  for(i=0;i<total;i++){
+    if(0 != columns){
+      data_stream.write((const char*)(att+start[i]),stride*sizeof(SVMFLOAT));
+    }
+    else{
+      x = get_example(i);
+      data_stream.write((const char*)x.att,x.length*sizeof(SVMFLOAT));
+    };
+  };
+  write_padding(data_stream,header.atts*sizeof(SVMFLOAT));
+  if(0 != columns){
+    data_stream.write((const char*)columns,cols*sizeof(svm_index));
+    write_padding(data_stream,cols*sizeof(svm_index));
+  }
+  else{
+    for(i=0;i<total;i++){
+      x = get_example(i);
+      data_stream.write((const char*)x.index,x.length*sizeof(svm_index));
+    };
+    write_padding(data_stream,header.atts*sizeof(svm_index));
+  };
+};
+
+
+int example_set_c::is_example_file(const char* filename){
+  char magic[8];
+  ifstream input_file(filename,ios::in|ios::binary);
+  if(input_file.bad()){
+    return 0;
+  };
+  input_file.read(magic,8);
+  if(input_file.gcount() != 8){
+    return 0;
+  };
+  return(0 == memcmp(magic,example_magic,8));
+};
+
+
+void example_set_c::load(const char* filename){
+  clear();
+#ifdef use_mmap
+  int fd = open(filename,O_RDONLY);
+  if(fd < 0){
+    throw read_exception("Could not open example file");
+  };
+  struct stat file_stat;
+  if(0 != fstat(fd,&file_stat)){
+    close(fd);
+    throw read_exception("Could not open example file");
+  };
+  file_size = file_stat.st_size;
+  void* mapped = MAP_FAILED;
+  if(file_size > 0){
+    mapped = mmap(0,file_size,PROT_READ,MAP_PRIVATE,fd,0);
+  };
+  close(fd);
+  if(MAP_FAILED == mapped){
+    file_size = 0;
+    throw read_exception("Could not map example file");
+  };
+  file_mem = (char*)mapped;
+  file_mapped = 1;
+#else
+  ifstream input_file(filename,ios::in|ios::binary);
+  if(input_file.bad()){
+    throw read_exception("Could not open example file");
+  };
+  input_file.seekg(0,ios::end);
+  file_size = input_file.tellg();
+  input_file.seekg(0,ios::beg);
+  file_mem = new char[file_size+1];
+  input_file.read(file_mem,file_size);
+  if(input_file.gcount() != file_size){
+    throw read_exception("Could not read example file");
+  };
+#endif
+
+  // check the header
+  if(file_size < (SVMINT)sizeof(example_header)){
+    throw read_exception("Example file is too short");
+  };
+  example_header* header = (example_header*)file_mem;
+  if(0 != memcmp(header->magic,example_magic,8)){
+    throw read_exception("Not an example file");
+  };
+  if(header->version != example_version){
+    throw read_exception("Example file has a different version (or byte order)");
+  };
+  if((header->size_int != (SVMINT)sizeof(SVMINT)) ||
+     (header->size_float != (SVMINT)sizeof(SVMFLOAT)) ||
+     (header->size_index != (SVMINT)sizeof(svm_index))){
+    throw read_exception("Example file was written with different number types");
+  };
+  // no array may be longer than the file, so the sizes cannot overflow
+  SVMINT count = header->count;
+  if((count < 0) || (header->dim < 0) || (header->dim >= MAXSVMINDEX) ||
+     (header->atts < 0) || (header->cols > header->dim) ||
+     (count >= file_size/(SVMINT)sizeof(SVMINT)) ||
+     (header->atts > file_size/(SVMINT)sizeof(SVMFLOAT)) ||
+     (header->atts > file_size/(SVMINT)sizeof(svm_index)) ||
+     (header->has_scale && (header->dim >= file_size/(SVMINT)sizeof(SVMFLOAT))) ||
+     ((header->cols >= 0) && (header->stride != matrix_stride(header->cols)))){
+    throw read_exception("Example file is damaged");
+  };
+
+  // find the arrays
+  SVMINT pos = padded_length(sizeof(example_header));
+  SVMINT exp_pos = pos;
+  if(header->has_scale){
+    pos += 2*padded_length((header->dim+1)*sizeof(SVMFLOAT));
+  };
+  SVMINT ys_pos = pos;
+  pos += padded_length(count*sizeof(SVMFLOAT));
+  SVMINT alphas_pos = pos;
+  pos += padded_length(count*sizeof(SVMFLOAT));
+  SVMINT start_pos = pos;
+  pos += padded_length((count+1)*sizeof(SVMINT));
+  SVMINT att_pos = pos;
+  pos += padded_length(header->atts*sizeof(SVMFLOAT));
+  SVMINT index_pos = pos;
+  if(header->cols >= 0){
+    pos += padded_length(header->cols*sizeof(svm_index));
+  }
+  else{
+    pos += padded_length(header->atts*sizeof(svm_index));
+  };
+  if(pos > file_size){
+    throw read_exception("Example file is too short");
+  };
+
+  // small arrays are copied, att and index stay in the file. scale()
+  // and the kernels use the attributes as indices of arrays of length
+  // dim, so they have to be ascending and below dim
+  SVMINT i;
+  SVMINT j;
+  SVMINT* file_start = (SVMINT*)(file_mem+start_pos);
+  svm_index* file_index = (svm_index*)(file_mem+index_pos);
+  if((file_start[0] != 0) || (file_start[count] != header->atts)){
+    throw read_exception("Example file is damaged");
+  };
+  for(i=0;i<count;i++){
+    if((file_start[i] > file_start[i+1]) ||
+       ((header->cols >= 0) && (file_start[i+1]-file_start[i] != header->stride))){
+      throw read_exception("Example file is damaged");
+    };
+    if(header->cols < 0){
+      for(j=file_start[i];j<file_start[i+1];j++){
+	if((file_index[j] < 0) || (file_index[j] >= header->dim) ||
+	   ((j > file_start[i]) && (file_index[j] <= file_index[j-1]))){
+	  throw read_exception("Example file is damaged");
+	};
+      };
+    };
+  };
+  for(j=0;j<header->cols;j++){
+    if((file_index[j] < 0) || (file_index[j] >= header->dim) ||
+       ((j > 0) && (file_index[j] <= file_index[j-1]))){
+      throw read_exception("Example file is damaged");
+    };
+  };
+  set_dim(header->dim);
+  resize(count);
+  SVMFLOAT* file_ys = (SVMFLOAT*)(file_mem+ys_pos);
+  SVMFLOAT* file_alphas = (SVMFLOAT*)(file_mem+alphas_pos);
+  for(i=0;i<count;i++){
+    start[i] = file_start[i];
+    length[i] = (header->cols >= 0) ? header->cols : file_start[i+1]-file_start[i];
+    ys[i] = file_ys[i];
+    alphas[i] = file_alphas[i];
+  };
+  examples_total = count;
+  att = (SVMFLOAT*)(file_mem+att_pos);
+  if(header->cols >= 0){
+    cols = header->cols;
+    stride = header->stride;
+    columns = new svm_index[cols+1];
+    for(i=0;i<cols;i++){
+      columns[i] = file_index[i];
+    };
+  }
+  else{
+    index = file_index;
+  };
+  atts_used = header->atts;
+  atts_capacity = header->atts;
+  if(header->has_scale){
+    Exp = new SVMFLOAT[dim+1];
+    Var = new SVMFLOAT[dim+1];
+    for(i=0;i<=dim;i++){
+      Exp[i] = ((SVMFLOAT*)(file_mem+exp_pos))[i];
+      Var[i] = ((SVMFLOAT*)(file_mem+exp_pos+padded_length((dim+1)*sizeof(SVMFLOAT))))[i];
+    };
+  };
+  my_format.sparse = header->sparse;
+  my_format.where_x = header->where_x;
+  my_format.where_y = header->where_y;
+  my_format.where_alpha = header->where_alpha;
+  my_format.delimiter = (char)header->delimiter;
+  my_format.binary = 1;
+  has_y = header->has_y;
+  has_alphas = header->has_alphas;
+  has_scale = header->has_scale;
+  has_pattern_y = header->has_pattern_y;
+  b = header->b;
+};
+
+
+// examples parsed from a block of lines of a file
+typedef struct read_chunk{
+  const char* begin;  // the lines
+  const char* end;
+  // format of the lines
+  int sparse;
+  int where_x;
+  int where_y;
+  int where_alpha;
+  char delimiter;
+  SVMINT dim;         // for dense lines
+  // the examples
+  SVMINT count;
+  SVMINT capacity;    // of length, ys and alphas
+  SVMINT* length;     // attributes of sparse example i
+  SVMFLOAT* ys;
+  SVMFLOAT* alphas;
+  SVMINT used;        // att[used..] is free
+  SVMINT atts_capacity;
+  SVMFLOAT* att;      // sparse attributes, or dim attributes per dense example
+  svm_index* index;
+  read_attrib* line;  // the current sparse line
+  SVMINT line_capacity;
+  SVMINT max_index;   // largest index of a sparse attribute
+  int has_y;
+  int has_alpha;
+  int wrapped;        // a dense example is not on a line of its own
+  char* error;        // message of the first error, 0 if none
+} READ_CHUNK;
+
+
+// thrown by read_example_lines() if operator >> has to read the examples
+class wrapped_lines_exception : public read_exception{
+ public:
+  wrapped_lines_exception() : read_exception("Examples are not on lines of their own - could not read examples"){};
+};
+
+
+static void init_chunk(read_chunk& chunk, const char* begin, const char* end){
+  chunk.begin = begin;
+  chunk.end = end;
+  chunk.count = 0;
+  chunk.capacity = 0;
+  chunk.length = 0;
+  chunk.ys = 0;
+  chunk.alphas = 0;
+  chunk.used = 0;
+  chunk.atts_capacity = 0;
+  chunk.att = 0;
+  chunk.index = 0;
+  chunk.line = 0;
+  chunk.line_capacity = 0;
+  chunk.max_index = -1;
+  chunk.has_y = 0;
+  chunk.has_alpha = 0;
+  chunk.wrapped = 0;
+  chunk.error = 0;
+};
+
+
+static void free_chunk(read_chunk& chunk){
+  if(chunk.length) free(chunk.length);
+  if(chunk.ys) free(chunk.ys);
+  if(chunk.alphas) free(chunk.alphas);
+  if(chunk.att) free(chunk.att);
+  if(chunk.index) free(chunk.index);
+  if(chunk.line) free(chunk.line);
+  init_chunk(chunk,0,0);
+};
+
+
+static void grow_chunk(read_chunk& chunk, const SVMINT new_atts){
+  // room for one more example with new_atts attributes
+  if(chunk.count == chunk.capacity){
+    chunk.capacity = 2*chunk.capacity+256;
+    chunk.length = (SVMINT*)realloc(chunk.length,chunk.capacity*sizeof(SVMINT));
+    chunk.ys = (SVMFLOAT*)realloc(chunk.ys,chunk.capacity*sizeof(SVMFLOAT));
+    chunk.alphas = (SVMFLOAT*)realloc(chunk.alphas,chunk.capacity*sizeof(SVMFLOAT));
+    if((0 == chunk.length) || (0 == chunk.ys) || (0 == chunk.alphas)){
+      throw general_exception("ERROR: Not enough memory for the examples");
+    };
+  };
+  if(chunk.used+new_atts > chunk.atts_capacity){
+    chunk.atts_capacity = 2*chunk.atts_capacity+new_atts+1024;
+    chunk.att = (SVMFLOAT*)realloc(chunk.att,chunk.atts_capacity*sizeof(SVMFLOAT));
+    if(chunk.sparse){
+      chunk.index = (svm_index*)realloc(chunk.index,chunk.atts_capacity*sizeof(svm_index));
+    };
+    if((0 == chunk.att) || (chunk.sparse && (0 == chunk.index))){
+      throw general_exception("ERROR: Not enough memory for the examples");
+    };
+  };
+};
+
+
+static int is_blank(const char c){
+  return ((' ' == c) || ('\t' == c) || ('\r' == c) || ('\f' == c));
+};
+
+
+static const char* skip_blanks(const char* p, const char* end){
+  while((p < end) && is_blank(*p)) p++;
+  return p;
+};
+
+
+static const char* line_end(const char* p, const char* end){
+  const char* found = (const char*)memchr(p,'\n',end-p);
+  return (0 == found) ? end : found;
+};
+
+
+static int starts_example(const char c){
+  return (('+' == c) || ('-' == c) || ('y' == c) || ('a' == c) ||
+	  ((c >= '0') && (c <= '9')));
+};
+
+
+static const char* next_field(const char* p, const char* end, const char delimiter,
+			      const char*& field, SVMINT& field_length){
+  // as readnext() within a line: an empty field between two delimiters
+  // is "0", the character after the field is removed
+  static const char zero[] = "0";
+  p = skip_blanks(p,end);
+  if((p < end) && (delimiter == *p)){
+    field = zero;
+    field_length = 1;
+  }
+  else{
+    field = p;
+    while((p < end) && (! is_blank(*p)) && (delimiter != *p)){
+      p++;
+    };
+    field_length = p-field;
+  };
+  if(p < end) p++;
+  return p;
+};
+
+
+static char* field_error(const char* text, const char* field, const SVMINT field_length){
+  char* t = new char[MAXCHAR];
+  strcpy(t,text);
+  SVMINT n = strlen(t);
+  SVMINT k;
+  for(k=0;(k<field_length) && (n<MAXCHAR-1);k++){
+    t[n] = field[k];
+    n++;
+  };
+  t[n] = '\0';
+  return t;
+};
+
+
+static void read_sparse_line(read_chunk& chunk, const char* p, const char* end){
+  const char* field;
+  SVMINT field_length;
+  SVMINT colon;
+  SVMINT n=0;
+  SVMINT pos;
+  SVMINT k;
+  SVMFLOAT y=0;
+  SVMFLOAT alpha=0;
+  while(1){
+    p = skip_blanks(p,end);
+    if(p >= end) break;
+    p = next_field(p,end,chunk.delimiter,field,field_length);
+    colon = 0;
+    while((colon < field_length) && (':' != field[colon])){
+      colon++;
+    };
+    if(colon == field_length){
+      // read y
+      try{
+	y = string2svmfloat(field,field_length);
+      }
+      catch(...){
+	throw read_exception("Class is no number - could not read example");
+      };
+      chunk.has_y = 1;
+    }
+    else if((colon > 0) && ('a' == field[colon-1])){
+      try{
+	alpha = string2svmfloat(field+colon+1,field_length-colon-1);
+      }
+      catch(...){
+	throw read_exception("Alpha is no number - could not read example");
+      };
+      chunk.has_alpha = 1;
+    }
+    else if((colon > 0) && ('y' == field[colon-1])){
+      try{
+	y = string2svmfloat(field+colon+1,field_length-colon-1);
+      }
+      catch(...){
+	throw read_exception("Class is no number - could not read example");
+      };
+      chunk.has_y = 1;
+    }
+    else{
+      // index from 1 to dim, read as by atoi()
+      int sign = 1;
+      k = 0;
+      if((k < colon) && (('+' == field[k]) || ('-' == field[k]))){
+	if('-' == field[k]) sign = -1;
+	k++;
+      };
+      pos = 0;
+      while((k < colon) && (field[k] >= '0') && (field[k] <= '9') && (pos <= MAXSVMINDEX)){
+	pos = pos*10+(field[k]-'0');
+	k++;
+      };
+      pos *= sign;
+      if(pos <= 0){
+	throw read_exception("Index number not positive.");
+      };
+      if(pos > MAXSVMINDEX){
+	throw general_exception("ERROR: Dimension of examples too large");
+      };
+      if(n == chunk.line_capacity){
+	chunk.line_capacity = 2*chunk.line_capacity+64;
+	chunk.line = (read_attrib*)realloc(chunk.line,chunk.line_capacity*sizeof(read_attrib));
+	if(0 == chunk.line){
+	  throw general_exception("ERROR: Not enough memory for the examples");
+	};
+      };
+      (chunk.line)[n].index = pos-1;
+      (chunk.line)[n].order = n;
+      try{
+	(chunk.line)[n].att = string2svmfloat(field+colon+1,field_length-colon-1);
+      }
+      catch(...){
+	throw read_exception(field_error("Attribute is no number - could not read example: ",
+					 field,field_length));
+      };
+      if(pos-1 > chunk.max_index) chunk.max_index = pos-1;
+      n++;
+    };
+  };
+  grow_chunk(chunk,n);
+  (chunk.length)[chunk.count] = sort_attributes(chunk.line,n,chunk.att+chunk.used,chunk.index+chunk.used);
+  chunk.used += (chunk.length)[chunk.count];
+  (chunk.ys)[chunk.count] = y;
+  (chunk.alphas)[chunk.count] = alpha;
+  chunk.count++;
+};
+
+
+static void read_dense_line(read_chunk& chunk, const char* p, const char* end){
+  const char* field;
+  SVMINT field_length;
+  SVMINT pos;
+  SVMFLOAT y=0;
+  SVMFLOAT alpha=0;
+  grow_chunk(chunk,chunk.dim);
+  SVMFLOAT* x = chunk.att+chunk.used;
+  for(int i=1;i<=3;i++){
+    if(i == chunk.where_x){
+      for(pos=0;pos<chunk.dim;pos++){
+	p = next_field(p,end,chunk.delimiter,field,field_length);
+	if(0 == field_length){
+	  chunk.wrapped = 1;
+	  throw read_exception("Not enough attributes - could not read examples");
+	};
+	try{
+	  x[pos] = string2svmfloat(field,field_length);
+	}
+	catch(...){
+	  throw read_exception(field_error("Attribute is no number - could not read example: ",
+					   field,field_length));
+	};
+      };
+    }
+    else if(i == chunk.where_y){
+      p = next_field(p,end,chunk.delimiter,field,field_length);
+      if(0 == field_length){
+	chunk.wrapped = 1;
+	throw read_exception("Not enough attributes - could not read examples");
+      };
+      try{
+	y = string2svmfloat(field,field_length);
+      }
+      catch(...){
+	throw read_exception("Class is no number - could not read example");
+      };
+      chunk.has_y = 1;
+    }
+    else if(i == chunk.where_alpha){
+      p = next_field(p,end,chunk.delimiter,field,field_length);
+      if(0 == field_length){
+	chunk.wrapped = 1;
+	throw read_exception("Not enough attributes - could not read examples");
+      };
+      try{
+	alpha = string2svmfloat(field,field_length);
+      }
+      catch(...){
+	throw read_exception("Alpha is no number - could not read example");
+      };
+      chunk.has_alpha = 1;
+    };
+  };
+  p = skip_blanks(p,end);
+  if((p < end) && ('#' != *p)){
+    chunk.wrapped = 1;
+    throw read_exception("Too many attributes - could not read examples");
+  };
+  chunk.used += chunk.dim;
+  (chunk.ys)[chunk.count] = y;
+  (chunk.alphas)[chunk.count] = alpha;
+  chunk.count++;
+};
+
+
+static void read_chunk_lines(read_chunk* chunk){
+  const char* p = chunk->begin;
+  const char* end;
+  const char* first;
+  try{
+    while(p < chunk->end){
+      end = line_end(p,chunk->end);
+      first = skip_blanks(p,end);
+      if((first < end) && ('#' != *first)){
+	if(chunk->sparse){
+	  read_sparse_line(*chunk,first,end);
+	}
+	else{
+	  read_dense_line(*chunk,first,end);
+	};
+      };
+      p = end+1;
+    };
+  }
+  catch(general_exception g){
+    chunk->error = g.error_msg;
+  };
+};
+
+
+#ifdef use_threads
+static void* read_worker(void* the_chunk){
+  read_chunk_lines((read_chunk*)the_chunk);
+  return 0;
+};
+#endif
+
+
+static void read_chunks(read_chunk* chunks, const SVMINT count){
+  // chunk 0 is read by this thread
+#ifdef use_threads
+  pthread_t* pool = 0;
+  int* started = 0;
+  SVMINT t;
+  if(count > 1){
+    pool = new pthread_t[count];
+    started = new int[count];
+    for(t=1;t<count;t++){
+      started[t] = (0 == pthread_create(&(pool[t]),0,read_worker,chunks+t));
+    };
+  };
+  read_chunk_lines(chunks);
+  for(t=1;t<count;t++){
+    if(started[t]){
+      pthread_join(pool[t],0);
+    }
+    else{
+      read_chunk_lines(chunks+t);
+    };
+  };
+  if(0 != pool) delete []pool;
+  if(0 != started) delete []started;
+#else
+  SVMINT t;
+  for(t=0;t<count;t++){
+    read_chunk_lines(chunks+t);
+  };
+#endif
+};
+
+
+static SVMINT read_threads(){
+#ifdef use_threads
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  if(cpus < 1) cpus = 1;
+  if(cpus > max_read_threads) cpus = max_read_threads;
+  return cpus;
+#else
+  return 1;
+#endif
+};
+
+
+static void put_chunk(example_set_c& examples, read_chunk& chunk){
+  // the examples of chunk, in order
+  SVMINT i;
+  SVMINT k;
+  if(chunk.sparse){
+    if(chunk.max_index >= examples.get_dim()){
+      examples.set_dim(chunk.max_index+1);
+    };
+    svm_example x;
+    SVMINT row=0;
+    for(i=0;i<chunk.count;i++){
+      x.length = (chunk.length)[i];
+      x.att = chunk.att+row;
+      x.index = chunk.index+row;
+      x.y = (chunk.ys)[i];
+      x.alpha = (chunk.alphas)[i];
+      examples.put_example(x);
+      row += x.length;
+    };
+  }
+  else{
+    SVMFLOAT* new_example = new SVMFLOAT[chunk.dim+2];
+    for(i=0;i<chunk.count;i++){
+      for(k=0;k<chunk.dim;k++){
+	new_example[k] = (chunk.att)[i*chunk.dim+k];
+      };
+      new_example[chunk.dim] = (chunk.ys)[i];
+      new_example[chunk.dim+1] = (chunk.alphas)[i];
+      examples.put_example(new_example);
+    };
+    delete []new_example;
+  };
+  if(chunk.has_y) examples.set_initialised_y();
+  if(chunk.has_alpha) examples.set_initialised_alpha();
+};
+
+
+static const char* read_word(const char* p, const char* end, char* s){
+  // as data_stream >> s
+  SVMINT n=0;
+  while((p < end) && (is_blank(*p) || ('\n' == *p) || ('\v' == *p))){
+    p++;
+  };
+  while((p < end) && (! (is_blank(*p) || ('\n' == *p) || ('\v' == *p))) && (n < MAXCHAR-1)){
+    s[n] = *p;
+    n++;
+    p++;
+  };
+  s[n] = '\0';
+  return p;
+};
+
+
+SVMINT read_example_lines(const char* data, const SVMINT data_length, example_set_c& examples){
+  char* s = new char[MAXCHAR]; // next word
+  const char* p = data;
+  const char* end = data+data_length;
+  long count=0; // number of examples read
+  char delimiter = examples.my_format.delimiter;
+  int sparse = examples.my_format.sparse;
+  int where_x = examples.my_format.where_x;
+  int where_y = examples.my_format.where_y;
+  int where_alpha = examples.my_format.where_alpha;
+  SVMINT given_total = 0;
+  SVMINT dim = examples.get_dim();
+  SVMINT threads = read_threads();
+  read_chunk* chunks = new read_chunk[threads];
+  SVMINT t;
+  for(t=0;t<threads;t++){
+    init_chunk(chunks[t],0,0);
+  };
+  const char* run_end;
+  const char* next_line;
+  const char* first;
+  SVMINT used_chunks;
+  char* error;
+
+  while((p < end) && ('@' != *p)){
+    if(is_blank(*p) || ('\n' == *p)){
+      // ignore
+      p++;
+    }
+    else if('#' == *p){
+      // line contains commentary
+      p = line_end(p,end);
+      if(p < end) p++;
+    }
+    else if(starts_example(*p)){
+      // the example lines up to the next other line
+      run_end = line_end(p,end);
+      while(run_end < end){
+	next_line = run_end+1;
+	run_end = line_end(next_line,end);
+	first = skip_blanks(next_line,run_end);
+	if((first < run_end) && ('#' != *first) && (! starts_example(*first))){
+	  run_end = next_line;
+	  break;
+	};
+      };
+      if((! sparse) && (dim <= 0)){
+	// the first line gives the dimension
+	const char* field;
+	SVMINT field_length;
+	next_line = line_end(p,run_end);
+	first = p;
+	SVMINT fields = 0;
+	while(skip_blanks(first,next_line) < next_line){
+	  first = next_field(first,next_line,delimiter,field,field_length);
+	  fields++;
+	};
+	dim = fields;
+	if(0 != where_y) dim--;
+	if(0 != where_alpha) dim--;
+	if(dim <= 0){
+	  throw read_exception("Not enough attributes - could not read examples");
+	};
+	examples.set_dim(dim);
+	read_chunk& chunk = chunks[0];
+	init_chunk(chunk,p,next_line);
+	chunk.sparse = 0;
+	chunk.where_x = where_x;
+	chunk.where_y = where_y;
+	chunk.where_alpha = where_alpha;
+	chunk.delimiter = delimiter;
+	chunk.dim = dim;
+	read_chunk_lines(&chunk);
+	if(chunk.wrapped){
+	  free_chunk(chunk);
+	  delete []chunks;
+	  delete []s;
+	  throw wrapped_lines_exception();
+	};
+	// as operator >>, y and alpha after x do not count here
+	if(where_y > where_x) chunk.has_y = 0;
+	if(where_alpha > where_x) chunk.has_alpha = 0;
+	examples.start_matrix();
+	put_chunk(examples,chunk);
+	count += chunk.count;
+	error = chunk.error;
+	free_chunk(chunk);
+	if(0 != error){
+	  throw read_exception(error);
+	};
+	p = (next_line < run_end) ? next_line+1 : run_end;
+      };
+      while(p < run_end){
+	// line-aligned chunks for all threads
+	used_chunks = 0;
+	while((p < run_end) && (used_chunks < threads)){
+	  read_chunk& chunk = chunks[used_chunks];
+	  next_line = run_end;
+	  if(run_end-p > read_chunk_size){
+	    next_line = line_end(p+read_chunk_size,run_end);
+	    if(next_line < run_end) next_line++;
+	  };
+	  init_chunk(chunk,p,next_line);
+	  chunk.sparse = sparse;
+	  chunk.where_x = where_x;
+	  chunk.where_y = where_y;
+	  chunk.where_alpha = where_alpha;
+	  chunk.delimiter = delimiter;
+	  chunk.dim = dim;
+	  used_chunks++;
+	  p = next_line;
+	};
+	read_chunks(chunks,used_chunks);
+	for(t=0;t<used_chunks;t++){
+	  if(chunks[t].wrapped){
+	    for(t=0;t<used_chunks;t++){
+	      free_chunk(chunks[t]);
+	    };
+	    delete []chunks;
+	    delete []s;
+	    throw wrapped_lines_exception();
+	  };
+	};
+	error = 0;
+	for(t=0;t<used_chunks;t++){
+	  if(0 == error){
+	    if(! sparse) examples.start_matrix();
+	    put_chunk(examples,chunks[t]);
+	    count += chunks[t].count;
+	    error = chunks[t].error;
+	  };
+	  free_chunk(chunks[t]);
+	};
+	if(0 != error){
+	  throw read_exception(error);
+	};
+	dim = examples.get_dim();
+      };
+    }
+    else{
+      // line contains parameters
+      p = read_word(p,end,s);
+      if((0 == strcmp("dimension",s)) || (0==strcmp("dim",s))){
+	p = read_word(p,end,s);
+	dim = atol(s);
+	examples.set_dim(dim);
+      }
+      else if(0 == strcmp("number",s)){
+	// number of examples, check later for consistency
+	p = read_word(p,end,s);
+	given_total = atol(s);
+	if(given_total > 0){
+	  examples.resize(examples.size()+given_total);
+	};
+      }
+      else if(0==strcmp("b",s)){
+	// hyperplane constant
+	p = read_word(p,end,s);
+	try{
+	  examples.b = string2svmfloat(s);
+	}
+	catch(...){
+	  throw read_exception("b is no number");
+	};
+      }
+      else if(0==strcmp("delimiter",s)){
+	p = read_word(p,end,s);
+	if((s[0] != '\0') && (s[1] != '\0')){
+	  delimiter = s[1];
+	}
+	else if(s[0] != '\0'){
+	  delimiter = s[0];
+	  if((p < end) && (' ' == *p)){
+	    // if delimiter = ' ' we have only read one '
+	    p++;
+	    if((p < end) && (delimiter == *p)){
+	      p++;
+	      delimiter = ' ';
+	    };
+	  };
+	}
+	else{
+	  delimiter = ' ';
+	};
+	examples.my_format.delimiter = delimiter;
+      }
+      else if(0==strcmp("format",s)){
+	p = read_word(p,end,s);
+	if(0==strcmp("sparse",s)){
+	  sparse = 1;
+	}
+	else{
+	  sparse = 0;
+	  where_x = 0;
+	  where_y = 0;
+	  where_alpha = 0;
+	  for(int i=0;s[i] != '\0';i++){
+	    if('x' == s[i]){
+	      where_x = i+1;
+	    }
+	    else if('y' == s[i]){
+	      where_y = i+1;
+	    }
+	    else if('a' == s[i]){
+	      where_alpha = i+1;
+	    }
+	    else{
+	      throw read_exception("Invalid format for examples");
+	    };
+	  };
+	  if(0 == where_x){
+	    throw read_exception("Invalid format for examples: x must be given");
+	  };
+	};
+	if(0 == where_y){ examples.has_y = 0; };
+	if(0 == where_alpha){ examples.has_alphas = 0; };
+	examples.my_format.sparse = sparse;
+	examples.my_format.where_x = where_x;
+	examples.my_format.where_y = where_y;
+	examples.my_format.where_alpha = where_alpha;
+      }
+      else{
+	char* t = new char[MAXCHAR];
+	strcpy(t,"Unknown parameter: ");
+	strcat(t,s);
+	throw read_exception(t);
+      };
+    };
+  };
+  delete []chunks;
+  delete []s;
+  examples.drop_zeros();
+  examples.compress();
+
+  // check for consistency
+  if((0 < given_total) && (count != given_total)){
+    cout<<"WARNING: Wrong number of examples read ("<<count<<" read instead of "<<given_total<<")."<<endl;
+  };
+  return p-data;
+};
+
+
+SVMINT read_examples(const char* data, const SVMINT data_length, example_set_c& examples){
+  // the state of an empty set to start again from
+  int was_empty = (0 == examples.size());
+  example_format old_format = examples.my_format;
+  SVMINT old_dim = examples.dim;
+  SVMFLOAT old_b = examples.b;
+  int old_has_y = examples.has_y;
+  int old_has_alphas = examples.has_alphas;
+  int old_has_pattern_y = examples.has_pattern_y;
+  try{
+    return read_example_lines(data,data_length,examples);
+  }
+  catch(wrapped_lines_exception &the_ex){
+    if(! was_empty) throw;
+  };
+  // dense examples that span or share lines, operator >> reads them
+  // token by token
+  examples.clear();
+  examples.set_dim(old_dim);
+  examples.my_format = old_format;
+  examples.b = old_b;
+  examples.has_y = old_has_y;
+  examples.has_alphas = old_has_alphas;
+  examples.has_pattern_y = old_has_pattern_y;
+  istrstream data_stream(data,data_length);
+  data_stream >> examples;
+  if(data_stream.eof()){
+    return data_length;
+  };
+  return data_stream.tellg();
+};
+
+
+istream& read_examples(istream& data_stream, const char* filename, example_set_c& examples){
+  // cin has no file name
+  if((0 == filename) || (&data_stream == &cin)){
+    return data_stream >> examples;
+  };
+  long start_pos = data_stream.tellg();
+  if(start_pos < 0){
+    return data_stream >> examples;
+  };
+  SVMINT used = 0;
+#ifdef use_mmap
+  int fd = open(filename,O_RDONLY);
+  if(fd < 0){
+    return data_stream >> examples;
+  };
+  struct stat file_stat;
+  SVMINT file_size = 0;
+  void* mapped = MAP_FAILED;
+  if((0 == fstat(fd,&file_stat)) && (file_stat.st_size > start_pos)){
+    file_size = file_stat.st_size;
+    mapped = mmap(0,file_size,PROT_READ,MAP_PRIVATE,fd,0);
+  };
+  close(fd);
+  if(MAP_FAILED == mapped){
+    return data_stream >> examples;
+  };
+  madvise(mapped,file_size,MADV_SEQUENTIAL);
+  try{
+    used = read_examples((char*)mapped+start_pos,file_size-start_pos,examples);
+  }
+  catch(...){
+    munmap(mapped,file_size);
+    throw;
+  };
+  munmap(mapped,file_size);
+#else
+  // read the rest of the file in one block
+  ifstream input_file(filename,ios::in|ios::binary);
+  if(input_file.bad()){
+    return data_stream >> examples;
+  };
+  input_file.seekg(0,ios::end);
+  long file_size = input_file.tellg();
+  if(file_size <= start_pos){
+    return data_stream >> examples;
+  };
+  char* data = new char[file_size-start_pos];
+  input_file.seekg(start_pos,ios::beg);
+  input_file.read(data,file_size-start_pos);
+  try{
+    used = read_examples(data,input_file.gcount(),examples);
+  }
+  catch(...){
+    delete []data;
+    throw;
+  };
+  delete []data;
+#endif
+  data_stream.seekg(start_pos+used);
+  return data_stream;
+};
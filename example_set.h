@@ -8,6 +8,40 @@
 #include <time.h>
 #include "globals.h"
 
+// alignment of att in bytes, so matrix rows suit SIMD code
+const SVMINT example_align = 64;
+
+// read_examples() gives each thread this many bytes of example lines
+const SVMINT read_chunk_size = 4194304;
+const SVMINT max_read_threads = 8;
+
+// first bytes of a binary example file
+#define example_magic "mySVMexs"
+// increase when the format changes
+const SVMINT example_version = 1;
+
+typedef struct example_header{
+  char magic[8];
+  SVMINT version;
+  SVMINT size_int;    // sizeof(SVMINT), sizeof(SVMFLOAT) and
+  SVMINT size_float;  // sizeof(svm_index) of the writer
+  SVMINT size_index;
+  SVMINT count;       // number of examples
+  SVMINT dim;
+  SVMINT atts;        // length of the attribute block
+  SVMINT cols;        // attributes of a matrix row, -1 for compressed rows
+  SVMINT stride;
+  SVMINT sparse;      // example_format of the text file
+  SVMINT where_x;
+  SVMINT where_y;
+  SVMINT where_alpha;
+  SVMINT delimiter;
+  SVMINT has_y;
+  SVMINT has_alphas;
+  SVMINT has_scale;   // Exp and Var given?
+  SVMINT has_pattern_y;
+  SVMFLOAT b;
+} EXAMPLE_HEADER;
 
 /**
  * Storage class for the examples
@@ -18,6 +52,26 @@
  * @li scaling
  * Attention! All access to the examples is call-by-reference.
  *
+ * The attributes of all examples are kept in compressed rows: example
+ * pos has length[pos] attributes att[start[pos]..] at index[start[pos]..],
+ * new examples are appended to these two blocks, which grow by realloc()
+ * to avoid copies. ys and alphas are separate arrays. get_example() only
+ * returns pointers into the blocks, they stay valid until the next
+ * put_example(), compress() or scale(). compress() puts the rows in the
+ * order of the examples without gaps.
+ *
+ * If all examples have the same attributes (dense input, after scaling)
+ * att is a matrix instead: every row has the cols attributes at
+ * columns[0..cols-1] and takes stride entries, padded with zeros to a
+ * multiple of example_align bytes, and there is no index block.
+ *
+ * With my_format.binary, operator << writes the set as binary example
+ * file: an example_header, Exp and Var (if scaled), ys, alphas, the row
+ * starts, att and index (or columns), each starting at a multiple of
+ * example_align bytes. load() maps such a file (#ifdef use_mmap, else it
+ * reads it into one block) and uses att and index in place, they are
+ * only copied when the attributes change.
+ *
  * @author Stefan Rueping <rueping@ls8.cs.uni-dortmund.de>
  * @version 0.1
  **/
@@ -26,27 +80,71 @@
 class example_set_c{
  private:
   SVMINT examples_total; // number of examples in the set
-  SVMINT capacity; // capacity of the_set
-  svm_example* the_set; // Vector of examples, each a array of dim+2 SVMFLOATs (x,y,alpha)
+  SVMINT capacity; // length of start, length, ys and alphas
+  SVMINT* start;   // first attribute of example pos, -1 if there is none
+  SVMINT* length;  // number of attributes of example pos
+  char* att_mem;   // att, aligned to example_align
+  SVMFLOAT* att;   // attributes of all examples
+  svm_index* index; // 0 for a matrix
+  svm_index* columns; // attributes of the matrix rows, 0 for compressed rows
+  SVMINT cols;
+  SVMINT stride;   // entries per matrix row
+  SVMINT atts_used;     // att[atts_used..] is free
+  SVMINT atts_capacity; // length of att and index
+  SVMFLOAT* ys;
+  SVMFLOAT* alphas;
   SVMFLOAT b; // constant of hyperplane (f(x) = wx+b)
   // Expectancy and variance, updated by scale(). Scale-factors may be needed later;
   SVMFLOAT* Exp; // size dim+1, last entry: y
   SVMFLOAT* Var;
   int has_y, has_alphas, has_scale, has_pattern_y; // do y_i and alpha_i and Exp,Var have correct values? Are all y in {-1,1}?
-  SVMFLOAT* all_alphas;
-  SVMFLOAT* all_ys;
   SVMINT dim; // dimensionality of the examples
   char* filename; // name of file examples were read from
+  char* file_mem;  // binary example file att and index point into, or 0
+  SVMINT file_size;
+  int file_mapped;
   /** 
    * really do the scaling work
    **/
   void do_scale();
+  /**
+   * room for new_atts more attributes, returns the start of the new row
+   **/
+  SVMINT reserve_atts(const SVMINT new_atts);
+  void resize_atts(const SVMINT new_capacity);
+  /**
+   * free att and index (or the file they are part of)
+   **/
+  void free_atts();
+  /**
+   * copy att and index out of the file
+   **/
+  void own_atts();
+  void set_row(const SVMINT pos, const SVMINT new_start, const SVMINT new_length);
+  SVMINT row_size(const SVMINT pos){ return (0 != columns) ? stride : length[pos]; };
+  /**
+   * copy the rows in the order of the examples into new blocks, as a
+   * matrix with the attributes new_columns (taken over) or, if that is 0,
+   * as compressed rows, without zeros if drop_zeros
+   **/
+  void repack(svm_index* new_columns, const SVMINT new_cols, const int drop_zeros);
+  /**
+   * store the examples of an empty set as a matrix of all dim attributes
+   **/
+  void start_matrix();
+  /**
+   * turn a matrix that is mostly zeros into compressed rows
+   **/
+  void drop_zeros();
+  void write_binary(ostream& data_stream);
  public:
   example_format my_format;
   void set_filename(char* new_filename); // name of file examples were read from
   char* get_filename(){ return(filename); };
   friend istream& operator >> (istream& data_stream, example_set_c& examples);
   friend ostream& operator << (ostream& data_stream, example_set_c& examples);
+  friend SVMINT read_examples(const char* data, const SVMINT data_length, example_set_c& examples);
+  friend SVMINT read_example_lines(const char* data, const SVMINT data_length, example_set_c& examples);
   /**
    * Constructor. Get Number of examples and dimensionality and set up data structures
    *
@@ -85,6 +183,11 @@ class example_set_c{
    **/
   void resize(SVMINT new_total);
   void compress();
+  /**
+   * Read a binary example file written by operator <<
+   **/
+  void load(const char* filename);
+  static int is_example_file(const char* filename);
   /**
    * Access functions to the examples.
    **/
@@ -93,6 +196,11 @@ class example_set_c{
   void put_example(const SVMINT pos, const svm_example example);
   void put_example(const svm_example example); // add one example
   svm_example get_example(const SVMINT pos);
+  /**
+   * attribute i of example pos at matrix[pos*matrix_stride+i] (zero for
+   * i >= dim), if the compressed set is stored like this, else 0
+   **/
+  SVMFLOAT* get_matrix(SVMINT& matrix_stride);
   void put_y(const SVMINT pos, const SVMFLOAT y);
   SVMFLOAT get_y(const SVMINT pos); // input y
   SVMFLOAT get_y_var();
@@ -136,6 +244,10 @@ class example_set_c{
    * scale first scaledim attributes to x[i] = (x[i] - const[i])/factor[i]
    **/
   void scale(SVMFLOAT *theconst, SVMFLOAT *thefactor,SVMINT scaledim);
+  /**
+   * were the examples scaled as by scale(theconst,thefactor,scaledim)?
+   **/
+  int scaled_by(SVMFLOAT *theconst, SVMFLOAT *thefactor, SVMINT scaledim);
   /**
    * get expectancy
    */ 
@@ -169,4 +281,19 @@ class example_set_c{
 ostream& operator<< (ostream& data_stream, example_set_c& examples);
 istream& operator>> (istream& data_stream, example_set_c& examples);
 
+/**
+ * Read the examples at the position of data_stream, which reads the file
+ * filename. As data_stream >> examples, but the file is mapped into
+ * memory and large blocks of example lines are parsed by several threads.
+ * If a dense example is not on a line of its own, the examples are read
+ * by operator >> from memory. data_stream is set behind the examples.
+ * Other streams are read by operator >>.
+ **/
+istream& read_examples(istream& data_stream, const char* filename, example_set_c& examples);
+/**
+ * Read examples from data[0..data_length-1], returns the number of bytes
+ * up to the next section
+ **/
+SVMINT read_examples(const char* data, const SVMINT data_length, example_set_c& examples);
+
 #endif
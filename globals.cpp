@@ -1,4 +1,9 @@
 #include "globals.h"
+#ifdef windows
+#include <time.h>
+#else
+#include <sys/time.h>
+#endif
 
 
 SVMFLOAT x_i(const svm_example x, const SVMINT i){
@@ -9,15 +14,15 @@ SVMFLOAT x_i(const svm_example x, const SVMINT i){
   SVMFLOAT result;
   while(low<high){
     med = (low+high)/2;
-    if(x.example[med].index>=i){
+    if(x.index[med]>=i){
       high=med;
     }
     else{
       low=med+1;
     };
   };
-  if((high < x.length) && (x.example[high].index==i)){
-    result = x.example[high].att;
+  if((high < x.length) && (x.index[high]==i)){
+    result = x.att[high];
   }
   else{
     result = 0;
@@ -27,11 +32,16 @@ SVMFLOAT x_i(const svm_example x, const SVMINT i){
 
 
 SVMFLOAT string2svmfloat(char* s){
-  // number =~ [+-]?\d+([.]\d+)?([Ee][+-]?\d+)?
   int size = 0;
   while(s[size] != '\0') size++;
+  return string2svmfloat(s,size);
+};
+
 
-  int char_read=0;
+SVMFLOAT string2svmfloat(const char* s, const SVMINT size){
+  // number =~ [+-]?\d+([.]\d+)?([Ee][+-]?\d+)?
+  // s needs no '\0' at s[size]
+  SVMINT char_read=0;
   SVMFLOAT number=0;
   int sign = 1;
   // sign
@@ -94,6 +104,16 @@ long get_time(){
 #endif
 };
 
+SVMFLOAT get_wall_time(){
+#ifdef windows
+  return(1e6*(SVMFLOAT)clock()/CLOCKS_PER_SEC);
+#else
+  struct timeval the_time;
+  gettimeofday(&the_time,0);
+  return(1e6*(SVMFLOAT)the_time.tv_sec+(SVMFLOAT)the_time.tv_usec);
+#endif
+};
+
 general_exception::general_exception(char* the_error){ error_msg = the_error; }
 general_exception::general_exception(){ error_msg = ""; }
 
@@ -102,7 +122,10 @@ read_exception::read_exception(){ error_msg = ""; }
 
 
 ostream& operator<< (ostream& data_stream, example_format& format){
-  if(format.sparse){
+  if(format.binary){
+    data_stream<<"binary";
+  }
+  else if(format.sparse){
     data_stream<<"sparse";
   }
   else{
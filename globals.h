@@ -8,7 +8,33 @@
 // uncomment the following line if you get problems with sys/times.h when compiling:
 #undef use_time
 
+// count kernel cache accesses, see kernel_c::get_cache_stats().
+// comment out the following line to remove the counters completely:
+#define use_cache_stats 1
+
+// compute kernel rows in background threads (needs pthreads).
+// comment out the following line if you have no pthreads:
+#define use_threads 1
+
+// use AVX2/AVX-512 code for dense examples if the cpu has it (gcc on x86).
+// comment out the following lines to use plain C++ only:
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define use_simd 1
+#endif
+
+// map binary model files into memory instead of reading them (needs mmap).
+// comment out the following line if you have no sys/mman.h:
+#define use_mmap 1
+
+// mysvm-serve listens on unix domain sockets (needs sys/socket.h).
+// comment out the following line to serve on stdin only:
+#define use_sockets 1
+
 #ifdef windows
+#undef use_threads
+#undef use_simd
+#undef use_mmap
+#undef use_sockets
 #undef use_time
 #define isnan _isnan
 #endif
@@ -45,14 +71,16 @@ typedef double SVMFLOAT;
 #define PI 3.1415926535
 
 
-typedef struct svm_attrib{
-  SVMFLOAT att;
-  SVMINT index;
-} SVM_ATTRIB;
+// index of an attribute, 32 bit to save memory
+typedef int svm_index;
+#define MAXSVMINDEX 2147483647
 
+// an example: its non-zero attributes att[k] at index[k] (ascending),
+// usually pointing into the storage of an example_set_c
 typedef struct svm_example{
   SVMINT length;
-  svm_attrib* example;
+  SVMFLOAT* att;
+  svm_index* index;
   SVMFLOAT y;
   SVMFLOAT alpha;
 } SVM_EXAMPLE;
@@ -78,6 +106,19 @@ typedef struct svm_result {
   SVMINT number_bsv;
 } SVM_RESULT;
 
+typedef struct cache_stats {
+  SVMINT accesses;
+  SVMINT hits;
+  SVMINT misses;
+  SVMINT evictions; // misses that replaced a cached row
+  SVMINT rows_computed;
+  SVMINT prefetched; // rows computed in the background
+  SVMINT kernel_evals;
+  SVMINT bytes_resident; // peak size of the cached rows
+  SVMFLOAT time_compute_row; // microseconds the solver spent in get_row()
+  SVMFLOAT time_prefetch;    // microseconds of the background threads
+} CACHE_STATS;
+
 typedef struct quadratic_program {
   SVMINT    n;   /* number of variables */
   SVMINT    m;   /* number of linear equality constraints */
@@ -98,6 +139,7 @@ class example_format{
   int where_y ;
   int where_alpha;
   char delimiter;
+  int binary; // written as binary example file
 };
 
 ostream& operator<< (ostream& data_stream, example_format& format);
@@ -128,8 +170,10 @@ class input_exception : public general_exception{};
 SVMFLOAT x_i(const svm_example x, const SVMINT i);
 
 SVMFLOAT string2svmfloat(char* s);
+SVMFLOAT string2svmfloat(const char* s, const SVMINT size);
 
 long get_time();
+SVMFLOAT get_wall_time(); // in microseconds, for short intervals
 
 #endif
 
@@ -62,6 +62,7 @@ istream& operator >> (istream& data_stream, kernel_container_c& the_kernel){
 	  delete the_kernel.kernel;
 	};
 	the_kernel.kernel = new kernel_lin_dot_c();
+	the_kernel.is_linear=1;
 	data_stream >> *(the_kernel.kernel);
       }
       else if(0 == strcmp("polynomial",s)){
@@ -208,21 +209,52 @@ kernel_c::kernel_c(){
   dim =0;
   cache_size=0;
   examples_size = 0;
-  rows = 0;
-  last_used = 0;
+  arena_mem = 0;
+  arena = 0;
+  arena_size = 0;
+  row_stride = 0;
+  slot_capacity = 0;
+  cache_float = 0;
+  gemm_rows = 0;
+  row_buffer = 0;
+  active = 0;
+  row_active = 0;
+  diag = 0;
+  norms = 0;
+  dense_mem = 0;
+  dense = 0;
+  dense_stride = 0;
   index = 0;
-  counter=0;
-  // cache profiling:
-  //  cache_misses = 0;
-  //  cache_access = 0;
+  slot_of = 0;
+  lru_prev = 0;
+  lru_next = 0;
+  lru_head = -1;
+  lru_tail = -1;
+  prefetch_threads = 0;
+  kernel_threads = 1;
+#ifdef use_threads
+  row_pool = 0;
+  prefetch_pool = 0;
+  prefetch_slot = 0;
+  prefetch_size = 0;
+  slot_pending = 0;
+#endif
+  clear_cache_stats();
 };
 
 kernel_c::~kernel_c(){
   //  cout<<"destructor"<<endl;
-  // cache profiling:
-  //  cout<<cache_access<<" access to the cache"<<endl;
-  //  cout<<cache_misses<<" cache misses ("<<100.0*(SVMFLOAT)cache_misses/((SVMFLOAT)cache_access)<<"%)"<<endl;
+#ifdef use_threads
+  stop_prefetch();
+  stop_row_pool();
+  if(prefetch_slot != 0) delete []prefetch_slot;
+#endif
   clean_cache();
+  free_arena();
+  if(active != 0) delete []active;
+  if(row_active != 0) delete []row_active;
+  if(diag != 0) delete []diag;
+  free_tables();
 };
 
 SVMFLOAT kernel_c::calculate_K(const SVMINT i, const SVMINT j){
@@ -237,9 +269,10 @@ SVMFLOAT kernel_c::calculate_K(const SVMINT i, const SVMINT j){
 //      && (last_used[pos_x] != 0) && (last_used[pos_y] != 0)){
 //     return rows[pos_x][j];
 //   };
-  svm_example x = the_examples->get_example(i);
-  svm_example y = the_examples->get_example(j);
-  return(calculate_K(x,y));
+#ifdef use_cache_stats
+  stats.kernel_evals++;
+#endif
+  return(K_examples(active[i],active[j]));
 };
 
 inline
@@ -253,22 +286,24 @@ SVMFLOAT kernel_c::innerproduct(const svm_example x, const svm_example y){
   // returns x*y
   SVMFLOAT result=0;
 
-  svm_attrib* att_x = x.example;
-  svm_attrib* att_y = y.example;
-  svm_attrib* length_x = &(att_x[x.length]);
-  svm_attrib* length_y = &(att_y[y.length]);
+  SVMFLOAT* att_x = x.att;
+  svm_index* index_x = x.index;
+  SVMFLOAT* att_y = y.att;
+  svm_index* index_y = y.index;
+  SVMINT length_x = x.length;
+  SVMINT length_y = y.length;
+  SVMINT pos_x=0;
+  SVMINT pos_y=0;
 
-  while((att_x < length_x) && (att_y < length_y)){
-    if(att_x->index == att_y->index){
-      result += (att_x->att)*(att_y->att);
-      att_x++;
-      att_y++;
+  while((pos_x < length_x) && (pos_y < length_y)){
+    if(index_x[pos_x] == index_y[pos_y]){
+      result += att_x[pos_x++]*att_y[pos_y++];
     }
-    else if(att_x->index < att_y->index){
-      att_x++;
+    else if(index_x[pos_x] < index_y[pos_y]){
+      pos_x++;
     }
     else{
-      att_y++;
+      pos_y++;
     };
   };
 
@@ -277,20 +312,7 @@ SVMFLOAT kernel_c::innerproduct(const svm_example x, const svm_example y){
 
 
 int kernel_c::cached(const SVMINT i){
-  int ok;
-  SVMINT pos = lookup(i);
-  if(index[pos] == i){
-    if(last_used[pos] > 0){
-      ok = 1;
-    }
-    else{
-      ok = 0;
-    };
-  }
-  else{
-    ok = 0;
-  };
-  return(ok);
+  return(lookup(i) < cache_size);
 };
 
 
@@ -299,31 +321,33 @@ SVMFLOAT kernel_c::norm2(const svm_example x, const svm_example y){
   SVMFLOAT result=0;
   SVMINT length_x = x.length;
   SVMINT length_y = y.length;
-  svm_attrib* att_x = x.example;
-  svm_attrib* att_y = y.example;
+  SVMFLOAT* att_x = x.att;
+  svm_index* index_x = x.index;
+  SVMFLOAT* att_y = y.att;
+  svm_index* index_y = y.index;
   SVMINT pos_x=0;
   SVMINT pos_y=0;
   SVMFLOAT dummy;
   while((pos_x < length_x) && (pos_y < length_y)){
-    if(att_x[pos_x].index == att_y[pos_y].index){
-      dummy = att_x[pos_x++].att-att_y[pos_y++].att;
+    if(index_x[pos_x] == index_y[pos_y]){
+      dummy = att_x[pos_x++]-att_y[pos_y++];
       result += dummy*dummy;
     }
-    else if(att_x[pos_x].index < att_y[pos_y].index){
-      dummy = att_x[pos_x++].att;
+    else if(index_x[pos_x] < index_y[pos_y]){
+      dummy = att_x[pos_x++];
       result += dummy*dummy;
     }
     else{
-      dummy = att_y[pos_y++].att;
+      dummy = att_y[pos_y++];
       result += dummy*dummy;
     };
   };
   while(pos_x < length_x){
-    dummy = att_x[pos_x++].att;
+    dummy = att_x[pos_x++];
     result += dummy*dummy;
   };
   while(pos_y < length_y){
-    dummy = att_y[pos_y++].att;
+    dummy = att_y[pos_y++];
     result += dummy*dummy;
   };
   return result;
@@ -336,104 +360,569 @@ int kernel_c::check(){
 
   cout<<"Checking cache"<<endl;
   SVMINT i;
-  // rows != 0
-  for(i=0;i<cache_size;i++){
-    if(rows[i] == 0){
-      cout<<"ERROR: row["<<i<<"] = 0"<<endl;
+  SVMINT pos;
+  // slot_of and index are inverse to each other
+  for(i=0;i<examples_size;i++){
+    pos = slot_of[i];
+    if((pos < -1) || (pos >= cache_size)){
+      cout<<"ERROR: slot_of["<<i<<"] = "<<pos<<endl;
+      result = 0;
+    }
+    else if((pos >= 0) && (index[pos] != i)){
+      cout<<"ERROR: index[slot_of["<<i<<"]] = "<<index[pos]<<endl;
       result = 0;
     };
   };
-  cout<<"rows[i] checked"<<endl;
+  cout<<"slot_of[i] checked"<<endl;
 
-  // 0 <= index <= examples_size
-  if(index != 0){
-    SVMINT last_i=index[0];
-    for(i=0;i<=cache_size;i++){
-      if(index[i]<0){
-	cout<<"ERROR: index["<<i<<"] = "<<index[i]<<endl;
+  // -1 <= index < examples_size
+  for(pos=0;pos<cache_size;pos++){
+    if(index[pos] >= 0){
+      if(index[pos] >= examples_size){
+	cout<<"ERROR: index["<<pos<<"] = "<<index[pos]<<endl;
 	result = 0;
-      };
-      if(index[i]>examples_size){
-	cout<<"ERROR: index["<<i<<"] = "<<index[i]<<endl;
-	result = 0;
-      };
-      if(index[i]<last_i){
-	cout<<"ERROR: index["<<i<<"] descending"<<endl;
+      }
+      else if(slot_of[index[pos]] != pos){
+	cout<<"ERROR: slot_of[index["<<pos<<"]] = "<<slot_of[index[pos]]<<endl;
 	result = 0;
       };
-      last_i = index[i];
+    }
+    else if(index[pos] != -1){
+      cout<<"ERROR: index["<<pos<<"] = "<<index[pos]<<endl;
+      result = 0;
     };
   };
   cout<<"index[i] checked"<<endl;
 
-  // 0 <= last_used <= counter
-  for(i=0;i<cache_size;i++){
-    if(last_used[i]<0){
-      cout<<"ERROR: last_used["<<i<<"] = "<<last_used[i]<<endl;
-      result = 0;
-    };
-    if(last_used[i]>counter){
-      cout<<"ERROR: last_used["<<i<<"] = "<<last_used[i]<<endl;
+  // LRU list contains each slot exactly once
+  SVMINT count=0;
+  SVMINT last=-1;
+  pos = lru_head;
+  while((pos >= 0) && (count <= cache_size)){
+    if(lru_prev[pos] != last){
+      cout<<"ERROR: lru_prev["<<pos<<"] = "<<lru_prev[pos]<<endl;
       result = 0;
     };
+    last = pos;
+    pos = lru_next[pos];
+    count++;
   };
-  cout<<"last_used[i] checked"<<endl;
-
-  cout<<"complete cache test"<<endl;
-  SVMFLOAT* adummy;
-  SVMINT i2;
-  for(i2=0;i2<cache_size;i2++){
-    cout<<i2<<" "; cout.flush();
-    adummy = new SVMFLOAT[examples_size];
-    for(SVMINT ai=0;ai<examples_size;ai++) adummy[ai] = (rows[i2])[ai];
-    delete [](rows[i2]);
-    rows[i] = adummy;
-  }
-  cout<<"cache test succeeded"<<endl;
-
-
+  if((count != cache_size) || (last != lru_tail)){
+    cout<<"ERROR: LRU list contains "<<count<<" of "<<cache_size<<" slots"<<endl;
+    result = 0;
+  };
+  cout<<"LRU list checked"<<endl;
 
   return result;
 };
 
 
 void kernel_c::init(SVMINT cache_MB, example_set_c* new_examples){
-//   cout<<"init"<<endl;
-//   cout<<"cache_size = "<<cache_size<<endl;
-//   cout<<"examples_size = "<<examples_size<<endl;
-//   cout<<"rows = "<<rows<<endl;
-//   if(rows != 0)cout<<"rows[0] = "<<rows[0]<<endl;
   clean_cache();
   the_examples = new_examples; 
   dim = the_examples->get_dim();
   cache_mem = cache_MB*1048576;
   // check if reserved memory big enough
-  if(cache_mem<(SVMINT)(sizeof(SVMFLOAT)*the_examples->size()+sizeof(SVMFLOAT*)+2*sizeof(SVMINT))){
-    // not enough space for one example, increaee
-    cache_mem = sizeof(SVMFLOAT)*the_examples->size()+sizeof(SVMFLOAT*)+2*sizeof(SVMINT);
+  SVMINT min_mem = padded(the_examples->size());
+  if(cache_mem<min_mem){
+    // not enough space for one example, increase
+    cache_mem = min_mem;
+  };
+  // one block for all rows
+  free_arena();
+  arena_size = cache_mem;
+  arena_mem = new char[arena_size+cache_align];
+  arena = arena_mem+((cache_align-((unsigned long)arena_mem)%cache_align)%cache_align);
+  if(active != 0) delete []active;
+  if(row_active != 0) delete []row_active;
+  if(diag != 0) delete []diag;
+  diag = 0; // computed when subclasses are initialised, too
+  free_tables();
+  compute_dense();
+  if((form_dist == get_form()) && (0 == dense)){
+    compute_norms();
+  };
+  clear_cache_stats();
+  active = new SVMINT[the_examples->size()];
+  row_active = new SVMINT[the_examples->size()];
+  reset_active();
+};
+
+
+void kernel_c::compute_norms(){
+  // by example, so shrinking only permutes active
+  SVMINT n = the_examples->size();
+  norms = new SVMFLOAT[n];
+  svm_example x;
+  SVMINT i;
+  for(i=0;i<n;i++){
+    x = the_examples->get_example(i);
+    norms[i] = innerproduct(x,x);
   };
-  set_examples_size(the_examples->size());
 };
 
 
-void kernel_c::clean_cache(){
-  counter=0;
-  if(rows != 0){
-    SVMINT i;
-    for(i=0;i<cache_size;i++){
-      if(0 != rows[i]){
-	delete [](rows[i]);
-	rows[i]=0;
+void kernel_c::compute_dense(){
+  // copy the examples to dense vectors if they are dense enough
+  if(form_general == get_form()) return;
+  SVMINT n = the_examples->size();
+  SVMINT used=0;
+  SVMINT i;
+  svm_example x;
+  SVMINT matrix_stride=0;
+  SVMFLOAT* matrix = the_examples->get_matrix(matrix_stride);
+  if((0 != matrix) && (n > 0) && (dim > 0) &&
+     (matrix_stride == ((dim+dense_block-1)/dense_block)*dense_block) &&
+     (0 == ((unsigned long)matrix)%cache_align)){
+    // the examples are dense vectors already, use them without a copy
+    init_dense();
+    dense_stride = matrix_stride;
+    dense = matrix;
+    return;
+  };
+  for(i=0;i<n;i++){
+    x = the_examples->get_example(i);
+    if((x.length > 0) && ((x.index)[x.length-1] >= dim)) return;
+    used += x.length;
+  };
+  if((n == 0) || (dim == 0) || (used < dense_density*n*dim)) return;
+
+  init_dense();
+  dense_stride = ((dim+dense_block-1)/dense_block)*dense_block;
+  dense_mem = new char[n*dense_stride*sizeof(SVMFLOAT)+cache_align];
+  dense = (SVMFLOAT*)(dense_mem+((cache_align-((unsigned long)dense_mem)%cache_align)%cache_align));
+  SVMFLOAT* row;
+  SVMINT k;
+  for(i=0;i<n;i++){
+    row = dense_row(i);
+    for(k=0;k<dense_stride;k++){
+      row[k] = 0;
+    };
+    x = the_examples->get_example(i);
+    for(k=0;k<x.length;k++){
+      row[(x.index)[k]] = (x.att)[k];
+    };
+  };
+};
+
+
+void kernel_c::free_tables(){
+  if(norms != 0) delete []norms;
+  norms = 0;
+  if(dense_mem != 0) delete []dense_mem;
+  dense_mem = 0;
+  dense = 0;
+  dense_stride = 0;
+};
+
+
+void kernel_c::scatter(const svm_example x, scattered_example& sx){
+  // x as dense vector of length dim or, for large dim, as hash table.
+  // attributes >= dim are dropped, the examples do not have them.
+  SVMINT k;
+  SVMINT index;
+  sx.values = 0;
+  sx.hash_index = 0;
+  sx.hash_att = 0;
+  sx.hash_mask = 0;
+  if(dim <= scatter_dim){
+    sx.values = new SVMFLOAT[dim];
+    for(k=0;k<dim;k++){
+      (sx.values)[k] = 0;
+    };
+    for(k=0;k<x.length;k++){
+      index = (x.index)[k];
+      if(index < dim){
+	(sx.values)[index] = (x.att)[k];
+      };
+    };
+  }
+  else{
+    SVMINT size=16;
+    while(size < 2*x.length){
+      size *= 2;
+    };
+    sx.hash_mask = size-1;
+    sx.hash_index = new SVMINT[size];
+    sx.hash_att = new SVMFLOAT[size];
+    for(k=0;k<size;k++){
+      (sx.hash_index)[k] = -1;
+    };
+    SVMINT pos;
+    for(k=0;k<x.length;k++){
+      index = (x.index)[k];
+      pos = (index*2654435761UL) & sx.hash_mask;
+      while((sx.hash_index)[pos] != -1){
+	pos = (pos+1) & sx.hash_mask;
+      };
+      (sx.hash_index)[pos] = index;
+      (sx.hash_att)[pos] = (x.att)[k];
+    };
+  };
+};
+
+
+void kernel_c::free_scatter(scattered_example& sx){
+  if(0 != sx.values) delete [](sx.values);
+  if(0 != sx.hash_index) delete [](sx.hash_index);
+  if(0 != sx.hash_att) delete [](sx.hash_att);
+  sx.values = 0;
+  sx.hash_index = 0;
+  sx.hash_att = 0;
+};
+
+
+inline
+SVMFLOAT kernel_c::gather_dot(const scattered_example& sx, const svm_example y){
+  // x*y for scattered x and an example y of the set
+  SVMFLOAT result=0;
+  SVMFLOAT* att_y = y.att;
+  svm_index* index_y = y.index;
+  SVMINT length_y = y.length;
+  SVMINT k;
+  if(0 != sx.values){
+    SVMFLOAT* values = sx.values;
+    for(k=0;k<length_y;k++){
+      result += values[index_y[k]]*att_y[k];
+    };
+  }
+  else{
+    SVMINT pos;
+    for(k=0;k<length_y;k++){
+      pos = (index_y[k]*2654435761UL) & sx.hash_mask;
+      while(((sx.hash_index)[pos] != -1) && ((sx.hash_index)[pos] != index_y[k])){
+	pos = (pos+1) & sx.hash_mask;
+      };
+      if((sx.hash_index)[pos] != -1){
+	result += (sx.hash_att)[pos]*att_y[k];
+      };
+    };
+  };
+  return result;
+};
+
+
+inline
+SVMFLOAT kernel_c::ex_dot(const SVMINT ex_x, const SVMINT ex_y){
+  if(0 != dense){
+    return dense_dot(dense_row(ex_x),dense_row(ex_y),dense_stride);
+  };
+  return innerproduct(the_examples->get_example(ex_x),the_examples->get_example(ex_y));
+};
+
+
+inline
+SVMFLOAT kernel_c::ex_dist2(const SVMINT ex_x, const SVMINT ex_y){
+  if(0 != dense){
+    return dense_dist2(dense_row(ex_x),dense_row(ex_y),dense_stride);
+  };
+  SVMFLOAT dist = norms[ex_x]+norms[ex_y]-2*ex_dot(ex_x,ex_y);
+  if(dist < 0) dist = 0;
+  return dist;
+};
+
+
+SVMFLOAT kernel_c::K_examples(const SVMINT ex_x, const SVMINT ex_y){
+  // K of two examples
+  int form = get_form();
+  if(form_dot == form){
+    return K_of_dot(ex_dot(ex_x,ex_y));
+  }
+  else if(form_dist == form){
+    return K_of_dist(ex_dist2(ex_x,ex_y));
+  };
+  return calculate_K(the_examples->get_example(ex_x),the_examples->get_example(ex_y));
+};
+
+
+void kernel_c::dot_positions(const SVMFLOAT* w, const SVMINT from, const SVMINT to, SVMFLOAT* result){
+  // for folding of linear kernels
+  SVMINT p;
+  if(0 != dense){
+    dense_dot_rows(w,dense,active+from,to-from,dense_stride,result);
+  }
+  else{
+    svm_example x;
+    SVMINT k;
+    for(p=from;p<to;p++){
+      x = the_examples->get_example(active[p]);
+      result[p-from] = 0;
+      for(k=0;k<x.length;k++){
+	result[p-from] += w[(x.index)[k]]*(x.att)[k];
+      };
+    };
+  };
+};
+
+
+void kernel_c::make_rows(const SVMINT* ex, const SVMINT count, kernel_rows& rows){
+  // copy the examples ex[k] to row k, contiguous and in the layout of the kernel
+  SVMINT k;
+  SVMINT j;
+  SVMINT length=0;
+  svm_example x;
+  rows.count = count;
+  rows.start = new SVMINT[count+1];
+  for(k=0;k<count;k++){
+    (rows.start)[k] = length;
+    length += (the_examples->get_example(ex[k])).length;
+  };
+  (rows.start)[count] = length;
+  rows.att = new SVMFLOAT[length];
+  rows.index = new svm_index[length];
+  for(k=0;k<count;k++){
+    x = the_examples->get_example(ex[k]);
+    for(j=0;j<x.length;j++){
+      (rows.att)[(rows.start)[k]+j] = (x.att)[j];
+      (rows.index)[(rows.start)[k]+j] = (x.index)[j];
+    };
+  };
+  complete_rows(rows);
+};
+
+
+void kernel_c::init_rows(const SVMINT new_dim, kernel_rows& rows){
+  // rows not made by make_rows(), e.g. read from a model file.
+  // the kernel then only evaluates queries against them
+  dim = new_dim;
+  free_tables();
+  SVMINT nnz = (rows.start)[rows.count];
+  if((form_general != get_form()) && (rows.count > 0) && (dim > 0) &&
+     (nnz >= dense_density*rows.count*dim)){
+    init_dense();
+    dense_stride = ((dim+dense_block-1)/dense_block)*dense_block;
+  };
+  complete_rows(rows);
+};
+
+
+void kernel_c::complete_rows(kernel_rows& rows){
+  // norms, order and dense rows from start, att and index
+  SVMINT count = rows.count;
+  SVMINT k;
+  SVMINT j;
+  svm_example x;
+  rows.norms = 0;
+  if(form_dist == get_form()){
+    rows.norms = new SVMFLOAT[count];
+    for(k=0;k<count;k++){
+      x = row_example(rows,k);
+      (rows.norms)[k] = innerproduct(x,x);
+    };
+  };
+  rows.order = new SVMINT[count];
+  for(k=0;k<count;k++){
+    (rows.order)[k] = k;
+  };
+  rows.dense_mem = 0;
+  rows.dense = 0;
+  rows.packed_mem = 0;
+  rows.packed = 0;
+  if(0 != dense_stride){
+    rows.dense_mem = new char[count*dense_stride*sizeof(SVMFLOAT)+cache_align];
+    rows.dense = (SVMFLOAT*)(rows.dense_mem+((cache_align-((unsigned long)rows.dense_mem)%cache_align)%cache_align));
+    SVMFLOAT* row;
+    for(k=0;k<count;k++){
+      row = rows.dense+k*dense_stride;
+      for(j=0;j<dense_stride;j++){
+	row[j] = 0;
       };
+      x = row_example(rows,k);
+      for(j=0;j<x.length;j++){
+	row[(x.index)[j]] = (x.att)[j];
+      };
+    };
+  };
+};
+
+
+void kernel_c::pack_rows(kernel_rows& rows){
+  // dense rows for dense_gemm(), see calculate_K_rows_block()
+  if((! gemm_rows) || (0 == rows.dense) || (0 != rows.packed)){
+    return;
+  };
+  rows.packed_mem = new char[dense_pack_size(rows.count,dense_stride)*sizeof(SVMFLOAT)+cache_align];
+  rows.packed = (SVMFLOAT*)(rows.packed_mem+((cache_align-((unsigned long)rows.packed_mem)%cache_align)%cache_align));
+  dense_pack(rows.dense,rows.count,dense_stride,rows.packed);
+};
+
+
+void kernel_c::free_rows(kernel_rows& rows){
+  if(0 != rows.start) delete [](rows.start);
+  if(0 != rows.att) delete [](rows.att);
+  if(0 != rows.index) delete [](rows.index);
+  if(0 != rows.norms) delete [](rows.norms);
+  if(0 != rows.dense_mem) delete [](rows.dense_mem);
+  if(0 != rows.packed_mem) delete [](rows.packed_mem);
+  if(0 != rows.order) delete [](rows.order);
+  rows.count = 0;
+  rows.start = 0;
+  rows.att = 0;
+  rows.index = 0;
+  rows.norms = 0;
+  rows.dense_mem = 0;
+  rows.dense = 0;
+  rows.packed_mem = 0;
+  rows.packed = 0;
+  rows.order = 0;
+};
+
+
+void kernel_c::rows_inner(const kernel_rows& rows, const SVMINT from, const SVMINT to, const kernel_query& query, SVMFLOAT* result){
+  // result[k-from] = x*query or ||x-query||^2 for row x = k, the rows come from this kernel
+  int form = get_form();
+  SVMINT count = to-from;
+  SVMINT k;
+  if(0 != query.dense){
+    if(form_dot == form){
+      dense_dot_rows(query.dense,rows.dense,rows.order+from,count,dense_stride,result);
+    }
+    else{
+      dense_dist2_rows(query.dense,rows.dense,rows.order+from,count,dense_stride,result);
+    };
+    return;
+  };
+  for(k=0;k<count;k++){
+    result[k] = gather_dot(query.scattered,row_example(rows,from+k));
+  };
+  if(form_dist == form){
+    for(k=0;k<count;k++){
+      result[k] = (rows.norms)[from+k]+query.norm-2*result[k];
+      if(result[k] < 0) result[k] = 0;
+    };
+  };
+};
+
+
+void kernel_c::make_query(const svm_example x, kernel_query& query){
+  // prepare K(ex,x) for all examples ex
+  query.x = x;
+  query.norm = 0;
+  query.dense = 0;
+  (query.scattered).values = 0;
+  (query.scattered).hash_index = 0;
+  (query.scattered).hash_att = 0;
+  if(form_general == get_form()){
+    return;
+  };
+  if(form_dist == get_form()){
+    query.norm = innerproduct(x,x);
+  };
+  if((0 == dense_stride) || 
+     ((x.length > 0) && ((x.index)[x.length-1] >= dim))){
+    // sparse, or attributes the examples do not have
+    scatter(x,query.scattered);
+  }
+  else{
+    query.dense = new SVMFLOAT[dense_stride];
+    SVMINT k;
+    for(k=0;k<dense_stride;k++){
+      (query.dense)[k] = 0;
     };
-    delete []rows;
+    for(k=0;k<x.length;k++){
+      (query.dense)[(x.index)[k]] = (x.att)[k];
+    };
+  };
+};
+
+
+void kernel_c::free_query(kernel_query& query){
+  if(0 != query.dense) delete [](query.dense);
+  query.dense = 0;
+  free_scatter(query.scattered);
+};
+
+
+SVMFLOAT kernel_c::calculate_K_query(const SVMINT ex, const kernel_query& query){
+  int form = get_form();
+  SVMFLOAT s;
+  if(form_dot == form){
+    if(0 != query.dense){
+      s = dense_dot(dense_row(ex),query.dense,dense_stride);
+    }
+    else{
+      s = gather_dot(query.scattered,the_examples->get_example(ex));
+    };
+    return K_of_dot(s);
+  }
+  else if(form_dist == form){
+    if(0 != query.dense){
+      s = dense_dist2(dense_row(ex),query.dense,dense_stride);
+    }
+    else if(0 != dense){
+      // ||ex||^2 from its dense row
+      SVMFLOAT* row = dense_row(ex);
+      s = dense_dot(row,row,dense_stride)+query.norm
+	-2*gather_dot(query.scattered,the_examples->get_example(ex));
+    }
+    else{
+      s = norms[ex]+query.norm-2*gather_dot(query.scattered,the_examples->get_example(ex));
+    };
+    if(s < 0) s = 0;
+    return K_of_dist(s);
+  };
+  return calculate_K(the_examples->get_example(ex),query.x);
+};
+
+
+void kernel_c::compute_diag(){
+  SVMINT n = the_examples->size();
+  diag = new SVMFLOAT[n];
+  svm_example x;
+  SVMINT i;
+  for(i=0;i<n;i++){
+    x = the_examples->get_example(i);
+    diag[i] = calculate_K(x,x);
   };
-  if(last_used != 0) delete []last_used;
+#ifdef use_cache_stats
+  stats.kernel_evals += n;
+#endif
+};
+
+
+void kernel_c::reset_active(){
+  // every example at its own position, forget cached rows
+  SVMINT i;
+  for(i=0;i<the_examples->size();i++){
+    active[i] = i;
+  };
+  clean_cache();
+  set_examples_size(the_examples->size());
+};
+
+
+void kernel_c::free_arena(){
+  wait_prefetch();
+  if(arena_mem != 0) delete []arena_mem;
+  arena_mem = 0;
+  arena = 0;
+  arena_size = 0;
+};
+
+
+void kernel_c::clean_cache(){
+  // forget all rows, the arena is kept
+  wait_prefetch();
+  update_resident();
   if(index != 0) delete []index;
-  rows=0;
-  last_used=0;
+  if(slot_of != 0) delete []slot_of;
+  if(lru_prev != 0) delete []lru_prev;
+  if(lru_next != 0) delete []lru_next;
+  if(row_buffer != 0) delete []row_buffer;
+  row_buffer=0;
+#ifdef use_threads
+  if(slot_pending != 0) delete []slot_pending;
+  slot_pending=0;
+#endif
   index=0;
+  slot_of=0;
+  lru_prev=0;
+  lru_next=0;
+  lru_head=-1;
+  lru_tail=-1;
   cache_size=0;
+  slot_capacity=0;
+  row_stride=0;
   examples_size=0;
 };
 
@@ -441,224 +930,679 @@ void kernel_c::clean_cache(){
 inline
 SVMINT kernel_c::lookup(const SVMINT i){
   // find row i in cache
-  // returns pos of element i if i in cache,
-  // returns pos of smallest element larger than i otherwise
-  SVMINT low;
-  SVMINT high;
-  SVMINT med;
-
-  low=0;
-  high=cache_size;
-  // binary search
-  while(low<high){
-    med = (low+high)/2;
-    if(index[med]>=i){
-      high=med;
-    }
-    else{
-      low=med+1;
-    };
+  // returns slot of row i if i in cache, cache_size otherwise
+  SVMINT pos = cache_size;
+  if((i >= 0) && (i < examples_size) && (slot_of[i] >= 0)){
+    pos = slot_of[i];
   };
-  return high;
+  return pos;
 };
 
 
-void kernel_c::overwrite(const SVMINT i, const SVMINT j){
-  // overwrite entry i with entry j
-  // WARNING: only to be used for shrinking!
+inline
+void kernel_c::lru_unlink(const SVMINT pos){
+  // remove slot pos from the LRU list
+  if(lru_prev[pos] >= 0){
+    lru_next[lru_prev[pos]] = lru_next[pos];
+  }
+  else{
+    lru_head = lru_next[pos];
+  };
+  if(lru_next[pos] >= 0){
+    lru_prev[lru_next[pos]] = lru_prev[pos];
+  }
+  else{
+    lru_tail = lru_prev[pos];
+  };
+};
 
-  // i in cache?
-  SVMINT pos_i=lookup(i);
-  SVMINT pos_j=lookup(j);
 
-  if((index[pos_i] == i) && (index[pos_j] == j)){
-    // swap pos_i and pos_j
-    SVMFLOAT* dummy = rows[pos_i];
-    rows[pos_i] = rows[pos_j];
-    rows[pos_j] = dummy;
-    last_used[pos_i] = last_used[pos_j];
+inline
+void kernel_c::lru_push_front(const SVMINT pos){
+  // slot pos becomes the most recently used
+  lru_prev[pos] = -1;
+  lru_next[pos] = lru_head;
+  if(lru_head >= 0){
+    lru_prev[lru_head] = pos;
   }
   else{
-    // mark rows as invalid
-    if(index[pos_i] == i){
-      last_used[pos_i] = 0;
-    }
-    else if(index[pos_j] == j){
-      last_used[pos_j] = 0;
-    };
+    lru_tail = pos;
   };
+  lru_head = pos;
+};
 
-  // swap i and j in all rows
-  SVMFLOAT* my_row;
-  for(pos_i=0;pos_i<cache_size;pos_i++){
-    my_row = rows[pos_i];
-    if(my_row != 0){
-      my_row[i] = my_row[j];
-    };
+
+inline
+void kernel_c::lru_push_back(const SVMINT pos){
+  // slot pos will be reused next
+  lru_next[pos] = -1;
+  lru_prev[pos] = lru_tail;
+  if(lru_tail >= 0){
+    lru_next[lru_tail] = pos;
+  }
+  else{
+    lru_head = pos;
   };
+  lru_tail = pos;
 };
 
 
 void kernel_c::set_examples_size(const SVMINT new_examples_size){
   // cache row with new_examples_size entries only
+  SVMINT pos;
+  wait_prefetch();
   
   // cout<<"shrinking from "<<examples_size<<" to "<<new_examples_size<<endl;
   if(new_examples_size>examples_size){
     clean_cache();
     examples_size = new_examples_size;
-    cache_size = cache_mem/(sizeof(SVMFLOAT)*examples_size+sizeof(SVMFLOAT*)+2*sizeof(SVMINT));
+    row_stride = padded(examples_size);
+    cache_size = arena_size/row_stride;
     if(cache_size>examples_size){
       cache_size = examples_size;
     };
+    // shrinking never needs more slots than this
+    slot_capacity = arena_size/cache_align;
+    if(slot_capacity>examples_size){
+      slot_capacity = examples_size;
+    };
+    if(cache_float){
+      row_buffer = new SVMFLOAT[examples_size];
+    };
+#ifdef use_threads
+    slot_pending = new char[slot_capacity];
+    for(pos=0;pos<slot_capacity;pos++){
+      slot_pending[pos] = 0;
+    };
+#endif
     // init 
-    rows = new SVMFLOAT*[cache_size];
-    last_used = new SVMINT[cache_size];
-    index = new SVMINT[cache_size+1];
-    SVMINT i;
-    for(i=0;i<cache_size;i++){
-      rows[i] = 0; // new SVMFLOAT[new_examples_size];
-      last_used[i] = 0;
-      index[i] = new_examples_size;
+    index = new SVMINT[slot_capacity];
+    lru_prev = new SVMINT[slot_capacity];
+    lru_next = new SVMINT[slot_capacity];
+    slot_of = new SVMINT[examples_size];
+    for(pos=0;pos<examples_size;pos++){
+      slot_of[pos] = -1;
+    };
+    for(pos=0;pos<cache_size;pos++){
+      index[pos] = -1;
+      lru_push_back(pos);
+    };
+    for(pos=0;pos<examples_size;pos++){
+      row_active[pos] = active[pos];
     };
-    index[cache_size] = new_examples_size;
   }
   else if(new_examples_size<examples_size){
-    // copy as much rows into new cache as possible
-    SVMINT old_cache_size=cache_size;
-    cache_size = cache_mem/(sizeof(SVMFLOAT)*new_examples_size+sizeof(SVMFLOAT*)+2*sizeof(SVMINT));
-    if(cache_size > new_examples_size){
-      cache_size = new_examples_size;
-    };
-    if(cache_size>=old_cache_size){
-      // skip it, enough space available
-      cache_size=old_cache_size;
-      return;
-    };
-
-    SVMFLOAT** new_rows = new SVMFLOAT*[cache_size];
-    SVMINT* new_last_used = new SVMINT[cache_size];
-    SVMINT* new_index = new SVMINT[cache_size+1];
-    SVMINT old_pos=0;
+    // The solver has permuted active and drops all positions from
+    // new_examples_size on. The columns of the cached rows are still
+    // in the order of row_active, gather them into the new order.
+    update_resident();
+    SVMINT p;
+    SVMINT* where = new SVMINT[the_examples->size()];
+    SVMINT* src = new SVMINT[new_examples_size];
+    for(p=0;p<examples_size;p++){
+      where[row_active[p]] = p;
+    };
+    for(p=0;p<new_examples_size;p++){
+      src[p] = where[active[p]];
+    };
+    // where[ex] = new position of example ex, -1 if shrinked
+    for(p=0;p<examples_size;p++){
+      where[row_active[p]] = -1;
+    };
+    for(p=0;p<new_examples_size;p++){
+      where[active[p]] = p;
+    };
+
+    SVMINT new_stride = padded(new_examples_size);
+    SVMINT new_cache_size = arena_size/new_stride;
+    if(new_cache_size > new_examples_size){
+      new_cache_size = new_examples_size;
+    };
+
+    // relabel the rows and remember LRU order of the remaining ones
+    SVMINT* order = new SVMINT[cache_size];
+    SVMINT* new_pos_of = new SVMINT[cache_size];
+    SVMINT live=0;
+    pos = lru_head;
+    while(pos >= 0){
+      if(index[pos] >= 0){
+	index[pos] = where[row_active[index[pos]]];
+	if(index[pos] >= 0){
+	  order[live] = pos;
+	  live++;
+	};
+      };
+      pos = lru_next[pos];
+    };
+    for(p=0;p<new_examples_size;p++){
+      slot_of[p] = -1;
+    };
+
+    // gather rows to the front of the arena with the new stride.
+    // The target never lies behind the source, so moving in
+    // ascending order does not overwrite rows still to be moved.
+    char* gathered = new char[new_examples_size*entry_size()];
     SVMINT new_pos=0;
-    new_index[cache_size] = new_examples_size;
-    while((old_pos<old_cache_size) && (new_pos < cache_size)){
-      if(last_used[old_pos] > 0){
-	// copy example into new cache at new_pos
-	new_rows[new_pos] = new SVMFLOAT[new_examples_size];
-	SVMINT j;
-	for(j=0;j<new_examples_size;j++){
-	  (new_rows[new_pos])[j] = (rows[old_pos])[j];
+    for(pos=0;pos<cache_size;pos++){
+      if(index[pos] >= 0){
+	if(cache_float){
+	  float* from = (float*)row_at(pos);
+	  float* to = (float*)gathered;
+	  for(p=0;p<new_examples_size;p++){
+	    to[p] = from[src[p]];
+	  };
+	}
+	else{
+	  SVMFLOAT* from = (SVMFLOAT*)row_at(pos);
+	  SVMFLOAT* to = (SVMFLOAT*)gathered;
+	  for(p=0;p<new_examples_size;p++){
+	    to[p] = from[src[p]];
+	  };
 	};
-	delete [](rows[old_pos]);
-	new_last_used[new_pos] = last_used[old_pos];
-	new_index[new_pos] = index[old_pos];
+	memcpy(arena+new_pos*new_stride,gathered,new_examples_size*entry_size());
+	index[new_pos] = index[pos];
+	slot_of[index[new_pos]] = new_pos;
+	new_pos_of[pos] = new_pos;
 	new_pos++;
-      }
-      else{
-	if(rows[old_pos] != 0){
-	  delete [](rows[old_pos]);
-	};
       };
-      old_pos++;
     };
-    while(new_pos < cache_size){
-      new_rows[new_pos] = 0; //new SVMFLOAT[new_examples_size];
-      new_last_used[new_pos] = 0;
-      new_index[new_pos] = new_examples_size;
+    while(new_pos < new_cache_size){
+      index[new_pos] = -1;
       new_pos++;
     };
-    while(old_pos < old_cache_size){
-      if(rows[old_pos] != 0){
-	delete [](rows[old_pos]);
-      };
-      old_pos++;
-    };
-    delete []rows;
-    rows = new_rows;
-    delete []last_used;
-    last_used = new_last_used;
-    delete []index;
-    index = new_index;
+
+    // rebuild LRU list, free slots are used first
+    lru_head = -1;
+    lru_tail = -1;
+    for(pos=0;pos<live;pos++){
+      lru_push_back(new_pos_of[order[pos]]);
+    };
+    for(pos=live;pos<new_cache_size;pos++){
+      lru_push_back(pos);
+    };
+    for(p=0;p<new_examples_size;p++){
+      row_active[p] = active[p];
+    };
+    delete []gathered;
+    delete []order;
+    delete []new_pos_of;
+    delete []where;
+    delete []src;
+
+    row_stride = new_stride;
+    cache_size = new_cache_size;
     examples_size = new_examples_size;
   };
-
 };
 
 
 void kernel_c::compute_row(const SVMINT i, SVMFLOAT* myrow){
-  // place row i in row
-  svm_example x = the_examples->get_example(i);
-  svm_example y;
+  // place row i in row, split into parts for the kernel threads
+  SVMINT parts = kernel_threads;
+  if(parts > examples_size/min_row_part){
+    parts = examples_size/min_row_part;
+  };
+#ifdef use_threads
+  if((parts > 1) && is_reentrant()){
+    if(0 == row_pool){
+      start_row_pool();
+    };
+    pthread_mutex_lock(&row_mutex);
+    row_job_i = i;
+    row_job = myrow;
+    row_parts = parts;
+    row_next_part = 1;
+    row_parts_left = parts-1;
+    pthread_cond_broadcast(&row_work);
+    pthread_mutex_unlock(&row_mutex);
+    // first part is done by this thread
+    compute_row_part(i,myrow,0,examples_size/parts);
+    pthread_mutex_lock(&row_mutex);
+    while(row_parts_left > 0){
+      pthread_cond_wait(&row_done,&row_mutex);
+    };
+    pthread_mutex_unlock(&row_mutex);
+    return;
+  };
+#endif
+  compute_row_part(i,myrow,0,examples_size);
+};
+
+
+void kernel_c::compute_row_part(const SVMINT i, SVMFLOAT* myrow, const SVMINT start, const SVMINT stop){
+  // place entries start..stop-1 of row i in row
+  SVMINT ex = active[i];
   SVMINT k;
-  for(k=0;k<examples_size;k++){
-    y = the_examples->get_example(k);
-    myrow[k] = calculate_K(x,y);
+  if(form_general != get_form()){
+    for(k=start;k<stop;k++){
+      myrow[k] = K_examples(ex,active[k]);
+    };
+  }
+  else{
+    svm_example x = the_examples->get_example(ex);
+    svm_example y;
+    for(k=start;k<stop;k++){
+      y = the_examples->get_example(active[k]);
+      myrow[k] = calculate_K(x,y);
+    };
   };
 };
 
 
-SVMFLOAT* kernel_c::get_row(const SVMINT i){
-  // lookup row in cache or compute
-  SVMINT low=0;
-  SVMINT high=cache_size;
-  SVMINT pos=0;
-  SVMINT j;
-  // binary search for i in [low,high]
-  high = lookup(i);
-  if(high==cache_size){
-    pos = high-1;
+void kernel_c::calculate_K_batch(const SVMINT* ex, const SVMINT count, const kernel_query& query, SVMFLOAT* result){
+  SVMINT k;
+  for(k=0;k<count;k++){
+    result[k] = calculate_K_query(ex[k],query);
+  };
+};
+
+
+void kernel_c::calculate_K_rows(const kernel_rows& rows, const SVMINT from, const SVMINT to, const kernel_query& query, SVMFLOAT* result){
+  int form = get_form();
+  SVMINT k;
+  if(form_general == form){
+    for(k=from;k<to;k++){
+      result[k-from] = calculate_K(row_example(rows,k),query.x);
+    };
+    return;
+  };
+  rows_inner(rows,from,to,query,result);
+  if(form_dot == form){
+    for(k=0;k<to-from;k++){
+      result[k] = K_of_dot(result[k]);
+    };
   }
   else{
-    pos=high;
+    for(k=0;k<to-from;k++){
+      result[k] = K_of_dist(result[k]);
+    };
   };
-  if((index[pos] != i) || (last_used[pos] == 0)){
-    // cache miss
-    SVMINT k;
-    if(index[pos] == i){
-      low = pos;
+};
+
+
+void kernel_c::calculate_K_rows_block(const kernel_rows& rows, const SVMINT from, const SVMINT to, const kernel_query* queries, const SVMINT count, SVMFLOAT* result){
+  SVMINT q;
+  for(q=0;q<count;q++){
+    calculate_K_rows(rows,from,to,queries[q],result+q*(to-from));
+  };
+};
+
+
+void kernel_c::set_gemm_rows(const int use_gemm){
+  gemm_rows = use_gemm;
+};
+
+
+void kernel_c::set_kernel_threads(const SVMINT threads){
+#ifdef use_threads
+  stop_row_pool();
+#endif
+  kernel_threads = threads;
+};
+
+
+#ifdef use_threads
+void kernel_c::start_row_pool(){
+  pthread_mutex_init(&row_mutex,0);
+  pthread_cond_init(&row_work,0);
+  pthread_cond_init(&row_done,0);
+  row_parts = 0;
+  row_next_part = 0;
+  row_parts_left = 0;
+  row_quit = 0;
+  // the calling thread computes one part itself
+  row_pool = new pthread_t[kernel_threads-1];
+  SVMINT t;
+  for(t=0;t<kernel_threads-1;t++){
+    pthread_create(&(row_pool[t]),0,row_worker,this);
+  };
+};
+
+
+void kernel_c::stop_row_pool(){
+  if(0 != row_pool){
+    pthread_mutex_lock(&row_mutex);
+    row_quit = 1;
+    pthread_cond_broadcast(&row_work);
+    pthread_mutex_unlock(&row_mutex);
+    SVMINT t;
+    for(t=0;t<kernel_threads-1;t++){
+      pthread_join(row_pool[t],0);
+    };
+    delete []row_pool;
+    row_pool = 0;
+    pthread_mutex_destroy(&row_mutex);
+    pthread_cond_destroy(&row_work);
+    pthread_cond_destroy(&row_done);
+  };
+};
+
+
+void* kernel_c::row_worker(void* the_kernel){
+  // compute parts of the row given to compute_row()
+  kernel_c* kernel = (kernel_c*)the_kernel;
+  SVMINT part;
+  SVMINT n;
+  pthread_mutex_lock(&(kernel->row_mutex));
+  while(1){
+    while((! kernel->row_quit) && 
+	  (kernel->row_next_part >= kernel->row_parts)){
+      pthread_cond_wait(&(kernel->row_work),&(kernel->row_mutex));
+    };
+    if(kernel->row_quit) break;
+    part = kernel->row_next_part;
+    kernel->row_next_part++;
+    n = kernel->examples_size;
+    pthread_mutex_unlock(&(kernel->row_mutex));
+
+    kernel->compute_row_part(kernel->row_job_i,kernel->row_job,
+			     part*n/kernel->row_parts,
+			     (part+1)*n/kernel->row_parts);
+
+    pthread_mutex_lock(&(kernel->row_mutex));
+    kernel->row_parts_left--;
+    if(0 == kernel->row_parts_left){
+      pthread_cond_broadcast(&(kernel->row_done));
+    };
+  };
+  pthread_mutex_unlock(&(kernel->row_mutex));
+  return 0;
+};
+#endif
+
+
+SVMINT kernel_c::fetch_row(const SVMINT i){
+  // lookup row in cache or compute, returns its slot
+  SVMINT pos = slot_of[i];
+#ifdef use_cache_stats
+  stats.accesses++;
+  // wall clock, so waiting for the background threads counts as well
+  SVMFLOAT time_start = get_wall_time();
+#endif
+#ifdef use_threads
+  if(pos >= 0){
+    // row may still be computed in the background
+    wait_slot(pos);
+  };
+#endif
+  if(pos < 0){
+    // cache miss, reuse least recently used slot
+    pos = lru_tail;
+#ifdef use_threads
+    wait_slot(pos);
+#endif
+    if(index[pos] >= 0){
+      slot_of[index[pos]] = -1;
+#ifdef use_cache_stats
+      stats.evictions++;
+#endif
+    };
+#ifdef use_cache_stats
+    stats.misses++;
+    stats.rows_computed++;
+    stats.kernel_evals += examples_size;
+#endif
+    if(cache_float){
+      compute_row(i,row_buffer);
+      float* my_row = (float*)row_at(pos);
+      SVMINT k;
+      for(k=0;k<examples_size;k++){
+	my_row[k] = (float)row_buffer[k];
+      };
     }
     else{
-      SVMINT min_time = last_used[cache_size-1];  // empty entries are at the end
-      low=cache_size-1;
-      for(k=0;k<cache_size;k++){
-	// search for last recently used element
-	if(last_used[k] < min_time){
-	  min_time = last_used[k];
-	  low = k;
-	};
+      compute_row(i,(SVMFLOAT*)row_at(pos));
+    };
+    index[pos] = i;
+    slot_of[i] = pos;
+  };
+  if(pos != lru_head){
+    lru_unlink(pos);
+    lru_push_front(pos);
+  };
+#ifdef use_cache_stats
+  stats.time_compute_row += get_wall_time() - time_start;
+#endif
+  return pos;
+};
+
+
+SVMFLOAT* kernel_c::get_row(const SVMINT i){
+  return((SVMFLOAT*)row_at(fetch_row(i)));
+};
+
+
+float* kernel_c::get_row_float(const SVMINT i){
+  return((float*)row_at(fetch_row(i)));
+};
+
+
+cache_stats kernel_c::get_cache_stats(){
+  // counters since the last init(), all 0 without use_cache_stats
+  update_resident();
+  cache_stats result = stats;
+  result.hits = stats.accesses-stats.misses;
+  return result;
+};
+
+
+void kernel_c::update_resident(){
+#ifdef use_cache_stats
+  SVMINT bytes = 0;
+  SVMINT pos;
+  for(pos=0;pos<cache_size;pos++){
+    if(index[pos] >= 0){
+      bytes += examples_size*entry_size();
+    };
+  };
+  if(bytes > stats.bytes_resident){
+    stats.bytes_resident = bytes;
+  };
+#endif
+};
+
+
+void kernel_c::clear_cache_stats(){
+  stats.accesses = 0;
+  stats.hits = 0;
+  stats.misses = 0;
+  stats.evictions = 0;
+  stats.rows_computed = 0;
+  stats.prefetched = 0;
+  stats.kernel_evals = 0;
+  stats.bytes_resident = 0;
+  stats.time_compute_row = 0;
+  stats.time_prefetch = 0;
+};
+
+
+void kernel_c::set_prefetch_threads(const SVMINT threads){
+#ifdef use_threads
+  stop_prefetch();
+#endif
+  prefetch_threads = threads;
+};
+
+
+void kernel_c::prefetch(const SVMINT* rows, const SVMINT count){
+  // start computing the rows not in cache in the background
+#ifdef use_threads
+  if((prefetch_threads <= 0) || (count >= cache_size) || (! is_reentrant())){
+    return;
+  };
+  wait_prefetch();
+  if(0 == prefetch_pool){
+    start_prefetch();
+  };
+  SVMINT k;
+  SVMINT i;
+  SVMINT pos;
+  // cached rows must not be evicted by the new ones
+  for(k=0;k<count;k++){
+    pos = slot_of[rows[k]];
+    if((pos >= 0) && (pos != lru_head)){
+      lru_unlink(pos);
+      lru_push_front(pos);
+    };
+  };
+  if(count > prefetch_size){
+    if(prefetch_slot != 0) delete []prefetch_slot;
+    prefetch_size = count;
+    prefetch_slot = new SVMINT[prefetch_size];
+  };
+  pthread_mutex_lock(&prefetch_mutex);
+  prefetch_count = 0;
+  prefetch_next = 0;
+  for(k=0;k<count;k++){
+    i = rows[k];
+    if(slot_of[i] < 0){
+      // reserve least recently used slot
+      pos = lru_tail;
+      if(index[pos] >= 0){
+	slot_of[index[pos]] = -1;
+#ifdef use_cache_stats
+	stats.evictions++;
+#endif
       };
+      index[pos] = i;
+      slot_of[i] = pos;
+      slot_pending[pos] = 1;
+      lru_unlink(pos);
+      lru_push_front(pos);
+      prefetch_slot[prefetch_count] = pos;
+      prefetch_count++;
+#ifdef use_cache_stats
+      stats.misses++;
+      stats.rows_computed++;
+      stats.prefetched++;
+      stats.kernel_evals += examples_size;
+#endif
+    };
+  };
+  if(prefetch_count > 0){
+    pthread_cond_broadcast(&prefetch_work);
+  };
+  pthread_mutex_unlock(&prefetch_mutex);
+#endif
+};
+
+
+void kernel_c::wait_prefetch(){
+  // wait until all prefetched rows are computed
+#ifdef use_threads
+  if(0 != prefetch_pool){
+    pthread_mutex_lock(&prefetch_mutex);
+    while((prefetch_next < prefetch_count) || (prefetch_running > 0)){
+      pthread_cond_wait(&prefetch_done,&prefetch_mutex);
+    };
+    pthread_mutex_unlock(&prefetch_mutex);
+  };
+#endif
+};
+
+
+#ifdef use_threads
+void kernel_c::wait_slot(const SVMINT pos){
+  // wait until the row in slot pos is computed
+  if(0 != prefetch_pool){
+    pthread_mutex_lock(&prefetch_mutex);
+    while(slot_pending[pos]){
+      pthread_cond_wait(&prefetch_done,&prefetch_mutex);
     };
-    
-    // delete low, calculate row i, place in high
-    SVMFLOAT* a_row = rows[low];
-    if(high<=low){
-      for(j=low;j>high;j--){
-	rows[j] = rows[j-1];
-	index[j] = index[j-1];
-	last_used[j] = last_used[j-1];
+    pthread_mutex_unlock(&prefetch_mutex);
+  };
+};
+
+
+void kernel_c::start_prefetch(){
+  pthread_mutex_init(&prefetch_mutex,0);
+  pthread_cond_init(&prefetch_work,0);
+  pthread_cond_init(&prefetch_done,0);
+  prefetch_count = 0;
+  prefetch_next = 0;
+  prefetch_running = 0;
+  prefetch_quit = 0;
+  prefetch_pool = new pthread_t[prefetch_threads];
+  SVMINT t;
+  for(t=0;t<prefetch_threads;t++){
+    pthread_create(&(prefetch_pool[t]),0,prefetch_worker,this);
+  };
+};
+
+
+void kernel_c::stop_prefetch(){
+  if(0 != prefetch_pool){
+    wait_prefetch();
+    pthread_mutex_lock(&prefetch_mutex);
+    prefetch_quit = 1;
+    pthread_cond_broadcast(&prefetch_work);
+    pthread_mutex_unlock(&prefetch_mutex);
+    SVMINT t;
+    for(t=0;t<prefetch_threads;t++){
+      pthread_join(prefetch_pool[t],0);
+    };
+    delete []prefetch_pool;
+    prefetch_pool = 0;
+    pthread_mutex_destroy(&prefetch_mutex);
+    pthread_cond_destroy(&prefetch_work);
+    pthread_cond_destroy(&prefetch_done);
+  };
+};
+
+
+void* kernel_c::prefetch_worker(void* the_kernel){
+  // compute rows of reserved slots until stop_prefetch()
+  kernel_c* kernel = (kernel_c*)the_kernel;
+  SVMINT pos;
+  SVMINT i;
+  SVMINT k;
+  SVMINT n;
+  pthread_mutex_lock(&(kernel->prefetch_mutex));
+  while(1){
+    while((! kernel->prefetch_quit) && 
+	  (kernel->prefetch_next >= kernel->prefetch_count)){
+      pthread_cond_wait(&(kernel->prefetch_work),&(kernel->prefetch_mutex));
+    };
+    if(kernel->prefetch_quit) break;
+    pos = kernel->prefetch_slot[kernel->prefetch_next];
+    kernel->prefetch_next++;
+    kernel->prefetch_running++;
+    i = kernel->index[pos];
+    n = kernel->examples_size;
+    pthread_mutex_unlock(&(kernel->prefetch_mutex));
+#ifdef use_cache_stats
+    SVMFLOAT time_start = get_wall_time();
+#endif
+
+    if(kernel->cache_float){
+      SVMFLOAT* buffer = new SVMFLOAT[n];
+      kernel->compute_row_part(i,buffer,0,n);
+      float* my_row = (float*)(kernel->row_at(pos));
+      for(k=0;k<n;k++){
+	my_row[k] = (float)buffer[k];
       };
+      delete []buffer;
     }
     else{
-      for(j=low;j<high-1;j++){
-	rows[j] = rows[j+1];
-	index[j] = index[j+1];
-	last_used[j] = last_used[j+1];
-      };
-      high--;
-    };
-    pos=high;
-    if(0 == a_row){
-      a_row = new SVMFLOAT[examples_size];
+      kernel->compute_row_part(i,(SVMFLOAT*)(kernel->row_at(pos)),0,n);
     };
-    rows[high] = a_row;
-    compute_row(i,a_row);
-    index[high]=i;
+
+    pthread_mutex_lock(&(kernel->prefetch_mutex));
+#ifdef use_cache_stats
+    kernel->stats.time_prefetch += get_wall_time() - time_start;
+#endif
+    kernel->slot_pending[pos] = 0;
+    kernel->prefetch_running--;
+    pthread_cond_broadcast(&(kernel->prefetch_done));
   };
+  pthread_mutex_unlock(&(kernel->prefetch_mutex));
+  return 0;
+};
+#endif
 
-  counter++;
-  last_used[pos] = counter;
 
-  return(rows[pos]);
+void kernel_c::set_cache_float(const int use_float){
+  cache_float = use_float;
 };
 
 
@@ -695,6 +1639,205 @@ ostream& operator << (ostream& data_stream, kernel_c& the_kernel){
  *
  */
 
+/*
+ *
+ * kernel_row_engine
+ *
+ */
+template<class Kernel>
+void kernel_row_engine<Kernel>::compute_row_part(const SVMINT i, SVMFLOAT* myrow, const SVMINT start, const SVMINT stop){
+  // place entries start..stop-1 of row i in row
+  Kernel* kernel = (Kernel*)this;
+  int form = kernel->Kernel::get_form();
+  SVMINT ex = active[i];
+  SVMINT* which = active+start;
+  SVMINT count = stop-start;
+  SVMFLOAT* result = myrow+start;
+  SVMINT k;
+  if(form_general == form){
+    svm_example x = the_examples->get_example(ex);
+    for(k=0;k<count;k++){
+      result[k] = kernel->Kernel::calculate_K(x,the_examples->get_example(which[k]));
+    };
+    return;
+  };
+
+  // first x*y or ||x-y||^2 for the whole part
+  if(0 != dense){
+    if(form_dot == form){
+      dense_dot_rows(dense_row(ex),dense,which,count,dense_stride,result);
+    }
+    else{
+      dense_dist2_rows(dense_row(ex),dense,which,count,dense_stride,result);
+    };
+  }
+  else{
+    scattered_example x;
+    scatter(the_examples->get_example(ex),x);
+    for(k=0;k<count;k++){
+      result[k] = gather_dot(x,the_examples->get_example(which[k]));
+    };
+    free_scatter(x);
+    if(form_dist == form){
+      for(k=0;k<count;k++){
+	result[k] = norms[ex]+norms[which[k]]-2*result[k];
+	if(result[k] < 0) result[k] = 0;
+      };
+    };
+  };
+
+  // then K
+  if(form_dot == form){
+    for(k=0;k<count;k++){
+      result[k] = kernel->Kernel::K_of_dot(result[k]);
+    };
+  }
+  else{
+    for(k=0;k<count;k++){
+      result[k] = kernel->Kernel::K_of_dist(result[k]);
+    };
+  };
+};
+
+
+template<class Kernel>
+void kernel_row_engine<Kernel>::calculate_K_batch(const SVMINT* ex, const SVMINT count, const kernel_query& query, SVMFLOAT* result){
+  Kernel* kernel = (Kernel*)this;
+  int form = kernel->Kernel::get_form();
+  SVMINT k;
+  if(form_general == form){
+    for(k=0;k<count;k++){
+      result[k] = kernel->Kernel::calculate_K(the_examples->get_example(ex[k]),query.x);
+    };
+    return;
+  };
+
+  if(0 != query.dense){
+    if(form_dot == form){
+      dense_dot_rows(query.dense,dense,ex,count,dense_stride,result);
+    }
+    else{
+      dense_dist2_rows(query.dense,dense,ex,count,dense_stride,result);
+    };
+  }
+  else{
+    for(k=0;k<count;k++){
+      result[k] = gather_dot(query.scattered,the_examples->get_example(ex[k]));
+    };
+    if(form_dist == form){
+      SVMFLOAT norm;
+      for(k=0;k<count;k++){
+	if(0 != dense){
+	  norm = dense_dot(dense_row(ex[k]),dense_row(ex[k]),dense_stride);
+	}
+	else{
+	  norm = norms[ex[k]];
+	};
+	result[k] = norm+query.norm-2*result[k];
+	if(result[k] < 0) result[k] = 0;
+      };
+    };
+  };
+
+  if(form_dot == form){
+    for(k=0;k<count;k++){
+      result[k] = kernel->Kernel::K_of_dot(result[k]);
+    };
+  }
+  else{
+    for(k=0;k<count;k++){
+      result[k] = kernel->Kernel::K_of_dist(result[k]);
+    };
+  };
+};
+
+
+template<class Kernel>
+void kernel_row_engine<Kernel>::calculate_K_rows(const kernel_rows& rows, const SVMINT from, const SVMINT to, const kernel_query& query, SVMFLOAT* result){
+  Kernel* kernel = (Kernel*)this;
+  int form = kernel->Kernel::get_form();
+  SVMINT k;
+  if(form_general == form){
+    for(k=from;k<to;k++){
+      result[k-from] = kernel->Kernel::calculate_K(row_example(rows,k),query.x);
+    };
+    return;
+  };
+  rows_inner(rows,from,to,query,result);
+  if(form_dot == form){
+    for(k=0;k<to-from;k++){
+      result[k] = kernel->Kernel::K_of_dot(result[k]);
+    };
+  }
+  else{
+    for(k=0;k<to-from;k++){
+      result[k] = kernel->Kernel::K_of_dist(result[k]);
+    };
+  };
+};
+
+
+template<class Kernel>
+void kernel_row_engine<Kernel>::calculate_K_rows_block(const kernel_rows& rows, const SVMINT from, const SVMINT to, const kernel_query* queries, const SVMINT count, SVMFLOAT* result){
+  // all x*y or ||x-y||^2 by one matrix product if rows and queries are dense
+  Kernel* kernel = (Kernel*)this;
+  int form = kernel->Kernel::get_form();
+  SVMINT n = to-from;
+  SVMINT q;
+  SVMINT k;
+  int use_gemm = ((0 != rows.packed) && (form_general != form) && (count > 0) && (0 == from%gemm_nr));
+  for(q=0;q<count;q++){
+    if(0 == queries[q].dense){
+      use_gemm = 0;
+    };
+  };
+  if(! use_gemm){
+    kernel_c::calculate_K_rows_block(rows,from,to,queries,count,result);
+    return;
+  };
+  const SVMFLOAT** x = new const SVMFLOAT*[count];
+  for(q=0;q<count;q++){
+    x[q] = queries[q].dense;
+  };
+  dense_gemm(x,count,rows.packed+from*dense_stride,n,dense_stride,result,n);
+  delete []x;
+  if(form_dot == form){
+    for(k=0;k<count*n;k++){
+      result[k] = kernel->Kernel::K_of_dot(result[k]);
+    };
+  }
+  else{
+    SVMFLOAT* r;
+    for(q=0;q<count;q++){
+      r = result+q*n;
+      for(k=0;k<n;k++){
+	r[k] = (rows.norms)[from+k]+queries[q].norm-2*r[k];
+	if(r[k] < 0) r[k] = 0;
+      };
+    };
+    kernel->Kernel::K_of_dist_block(result,count*n);
+  };
+};
+
+
+template<class Kernel>
+void kernel_row_engine<Kernel>::K_of_dist_block(SVMFLOAT* d, const SVMINT n){
+  Kernel* kernel = (Kernel*)this;
+  SVMINT k;
+  for(k=0;k<n;k++){
+    d[k] = kernel->Kernel::K_of_dist(d[k]);
+  };
+};
+
+
+template class kernel_row_engine<kernel_dot_c>;
+template class kernel_row_engine<kernel_lin_dot_c>;
+template class kernel_row_engine<kernel_polynomial_c>;
+template class kernel_row_engine<kernel_radial_c>;
+template class kernel_row_engine<kernel_neural_c>;
+template class kernel_row_engine<kernel_anova_c>;
+
+
 /*
  *
  * kernel_dot_c
@@ -770,7 +1913,7 @@ void kernel_lin_dot_c::input(istream& data_stream){
       if(0 == strcmp("a",s)){
 	data_stream >> a;
       }
-      if(0 == strcmp("b",s)){
+      else if(0 == strcmp("b",s)){
 	data_stream >> b;
       }
       else{
@@ -789,7 +1932,7 @@ void kernel_lin_dot_c::input(istream& data_stream){
 
 
 void kernel_lin_dot_c::output(ostream& data_stream) const{
-  data_stream<<"type dot"<<endl;
+  data_stream<<"type lin_dot"<<endl;
   data_stream<<"a "<<a<<endl;
   data_stream<<"b "<<b<<endl;
 };
@@ -801,7 +1944,11 @@ void kernel_lin_dot_c::output(ostream& data_stream) const{
  *
  */
 SVMFLOAT kernel_polynomial_c::calculate_K(const svm_example x, const svm_example y){
-  SVMFLOAT prod=1+innerproduct(x,y);
+  return K_of_dot(innerproduct(x,y));
+};
+
+SVMFLOAT kernel_polynomial_c::K_of_dot(const SVMFLOAT s){
+  SVMFLOAT prod=1+s;
   SVMFLOAT result=1;
   SVMINT i;
   for(i=0;i<degree;i++) result *= prod;
@@ -864,6 +2011,15 @@ SVMFLOAT kernel_radial_c::calculate_K(const svm_example x, const svm_example y){
   return exp(-gamma*norm2(x,y));
 };
 
+
+void kernel_radial_c::K_of_dist_block(SVMFLOAT* d, const SVMINT n){
+  SVMINT k;
+  for(k=0;k<n;k++){
+    d[k] *= -gamma;
+  };
+  dense_exp(d,n);
+};
+
 void kernel_radial_c::input(istream& data_stream){
   // read comments and parameters until next @
   char next = data_stream.peek();
@@ -980,34 +2136,36 @@ SVMFLOAT kernel_anova_c::calculate_K(const svm_example x, const svm_example y){
   SVMFLOAT result=0;
   SVMINT length_x = x.length;
   SVMINT length_y = y.length;
-  svm_attrib* att_x = x.example;
-  svm_attrib* att_y = y.example;
+  SVMFLOAT* att_x = x.att;
+  svm_index* index_x = x.index;
+  SVMFLOAT* att_y = y.att;
+  svm_index* index_y = y.index;
   SVMINT pos_x=0;
   SVMINT pos_y=0;
   SVMINT zeros=dim;
   SVMFLOAT diff;
   while((pos_x < length_x) && (pos_y < length_y)){
-    if(att_x[pos_x].index == att_y[pos_y].index){
-      diff = att_x[pos_x++].att-att_y[pos_y++].att;
+    if(index_x[pos_x] == index_y[pos_y]){
+      diff = att_x[pos_x++]-att_y[pos_y++];
       result += exp(-gamma*(diff*diff));
     }
-    else if(att_x[pos_x].index < att_y[pos_y].index){
-      diff = att_x[pos_x++].att;
+    else if(index_x[pos_x] < index_y[pos_y]){
+      diff = att_x[pos_x++];
       result += exp(-gamma*(diff*diff));
     }
     else{
-      diff = att_y[pos_y++].att;
+      diff = att_y[pos_y++];
       result += exp(-gamma*(diff*diff));
     };
     zeros--;
   };
   while(pos_x < length_x){
-    diff = att_x[pos_x++].att;
+    diff = att_x[pos_x++];
     result += exp(-gamma*(diff*diff));
     zeros--;
   };
   while(pos_y < length_y){
-    diff = att_y[pos_y++].att;
+    diff = att_y[pos_y++];
     result += exp(-gamma*(diff*diff));
     zeros--;
   };
@@ -1083,18 +2241,20 @@ SVMFLOAT kernel_exponential_c::calculate_K(const svm_example x, const svm_exampl
   SVMFLOAT result=0;
   SVMINT length_x = x.length;
   SVMINT length_y = y.length;
-  svm_attrib* att_x = x.example;
-  svm_attrib* att_y = y.example;
+  SVMFLOAT* att_x = x.att;
+  svm_index* index_x = x.index;
+  SVMFLOAT* att_y = y.att;
+  svm_index* index_y = y.index;
   SVMINT pos_x=0;
   SVMINT pos_y=0;
   SVMINT i=0;
   SVMFLOAT mylambda=1;
   while((pos_x < length_x) && (pos_y < length_y)){
-    if(att_x[pos_x].index == att_y[pos_y].index){
-      for(;i<att_x[pos_x].index;i++) mylambda *= lambda;
-      result += mylambda*att_x[pos_x++].att*att_y[pos_y++].att;
+    if(index_x[pos_x] == index_y[pos_y]){
+      for(;i<index_x[pos_x];i++) mylambda *= lambda;
+      result += mylambda*att_x[pos_x++]*att_y[pos_y++];
     }
-    else if(att_x[pos_x].index < att_y[pos_y].index){
+    else if(index_x[pos_x] < index_y[pos_y]){
       pos_x++;
     }
     else{
@@ -1164,8 +2324,6 @@ kernel_aggregation_c::kernel_aggregation_c(){
   elements = 0;
   from = 0;
   to = 0;
-  new_x.example = 0;
-  new_y.example = 0;
 };
 
 
@@ -1179,8 +2337,6 @@ kernel_aggregation_c::~kernel_aggregation_c(){
     to = 0;
     number_elements = 0;
   };
-  if(new_x.example){ delete []new_x.example; };
-  if(new_y.example){ delete []new_y.example; };
 };
 
 
@@ -1190,9 +2346,49 @@ void kernel_aggregation_c::init(SVMINT new_cache_MB,example_set_c* new_examples)
   for(i=0;i<number_elements;i++){
     (elements[i])->init(0,new_examples);
     (elements[i])->dim = to[i]-from[i];
+    // the parts only see parts of examples
+    (elements[i])->free_tables();
   };
-  new_x.example = new svm_attrib[dim];
-  new_y.example = new svm_attrib[dim];
+};
+
+
+void kernel_aggregation_c::init_rows(const SVMINT new_dim, kernel_rows& rows){
+  // as init(), without examples
+  kernel_c::init_rows(new_dim,rows);
+  SVMINT i;
+  for(i=0;i<number_elements;i++){
+    (elements[i])->dim = to[i]-from[i];
+    (elements[i])->free_tables();
+  };
+};
+
+
+int kernel_aggregation_c::is_reentrant(){
+  SVMINT i;
+  for(i=0;i<number_elements;i++){
+    if(! (elements[i])->is_reentrant()){
+      return 0;
+    };
+  };
+  return 1;
+};
+
+
+SVMINT kernel_aggregation_c::get_part(const svm_example x, const SVMINT i, svm_example& part){
+  // the attributes of x in range i: the values stay in x, the indices
+  // are shifted into part.index. returns their number
+  SVMINT start=0;
+  while((start<x.length) && ((x.index)[start] < from[i])){
+    start++;
+  };
+  SVMINT count=0;
+  part.att = x.att+start;
+  while((start+count<x.length) && ((x.index)[start+count] < to[i])){
+    (part.index)[count] = (x.index)[start+count]-from[i];
+    count++;
+  };
+  part.length = count;
+  return count;
 };
 
 
@@ -1302,49 +2498,24 @@ void kernel_aggregation_c::output(ostream& data_stream)const{
 
 SVMFLOAT kernel_aggregation_c::calculate_K(const svm_example x, const svm_example y){
   SVMFLOAT result=0;
-  //  svm_example  new_x = x;
-  //  svm_example new_y = y;
-  SVMINT start;
-  SVMINT stop;
-  SVMINT count;
+  // local copies of the parts, so calculate_K may run in parallel
+  svm_index x_buffer[aggregation_buffer];
+  svm_index y_buffer[aggregation_buffer];
+  svm_example new_x;
+  svm_example new_y;
+  new_x.index = (x.length <= aggregation_buffer) ? x_buffer : new svm_index[x.length];
+  new_y.index = (y.length <= aggregation_buffer) ? y_buffer : new svm_index[y.length];
 
   for(SVMINT i=0;i<number_elements;i++){
     // find matching part of x and y
-    start=0;
-    while((start<x.length) && (((x.example)[start]).index < from[i])){
-      start++;
-    };
-    //    new_x.example = x.example + start;
-    stop=start;
-    count=0;
-    while((stop<x.length) && (((x.example)[stop]).index < to[i])){
-      (new_x.example)[count] = (x.example)[stop];
-      ((new_x.example)[count]).index -= from[i]; 
-      //      cout<<"x: "<<((new_x.example)[count]).index<<" --> "<<((new_x.example)[count]).att<<endl;
-      count++;
-      stop++;
-    };
-    new_x.length = stop-start;
-    start=0;
-    while((start<y.length) && (((y.example)[start]).index < from[i])){
-      start++;
-    };
-    //    new_y.example = y.example + start;
-    stop=start;
-    count=0;
-    while((stop<y.length) && (((y.example)[stop]).index < to[i])){
-      (new_y.example)[count] = (y.example)[stop];
-      ((new_y.example)[count]).index -= from[i]; 
-      //      cout<<"y: "<<((new_y.example)[count]).index<<" --> "<<((new_y.example)[count]).att<<endl;
-      count++;
-      stop++;
-    };
-    new_y.length = stop-start;
+    get_part(x,i,new_x);
+    get_part(y,i,new_y);
 
     // default ist sum-kernel
     result += (elements[i])->calculate_K(new_x,new_y);
   };
-  //  exit(1);
+  if(new_x.index != x_buffer) delete [](new_x.index);
+  if(new_y.index != y_buffer) delete [](new_y.index);
   return result;
 };
 
@@ -1361,8 +2532,6 @@ kernel_prod_aggregation_c::kernel_prod_aggregation_c(){
   elements = 0;
   from = 0;
   to = 0;
-  new_x.example = 0;
-  new_y.example = 0;
 };
 
 
@@ -1376,8 +2545,6 @@ kernel_prod_aggregation_c::~kernel_prod_aggregation_c(){
     to = 0;
     number_elements = 0;
   };
-  if(new_x.example){ delete []new_x.example; };
-  if(new_y.example){ delete []new_y.example; };
 };
 
 
@@ -1389,47 +2556,22 @@ void kernel_prod_aggregation_c::output(ostream& data_stream)const{
 
 SVMFLOAT kernel_prod_aggregation_c::calculate_K(const svm_example x, const svm_example y){
   SVMFLOAT result=1;
-  //  svm_example new_x = x;
-  //  svm_example new_y = y;
-  SVMINT start;
-  SVMINT stop;
-  SVMINT count;
+  svm_index x_buffer[aggregation_buffer];
+  svm_index y_buffer[aggregation_buffer];
+  svm_example new_x;
+  svm_example new_y;
+  new_x.index = (x.length <= aggregation_buffer) ? x_buffer : new svm_index[x.length];
+  new_y.index = (y.length <= aggregation_buffer) ? y_buffer : new svm_index[y.length];
   SVMINT i;
   for(i=0;i<number_elements;i++){
     // find matching part of x and y
-    start=0;
-    while((start<x.length) && (((x.example)[start]).index < from[i])){
-      start++;
-    };
-    //    new_x.example = x.example + start;
-    stop=start;
-    count=0;
-    while((stop<x.length) && (((x.example)[stop]).index < to[i])){
-      (new_x.example)[count] = (x.example)[stop];
-      ((new_x.example)[count]).index -= from[i]; 
-      count++;
-      stop++;
-    };
-    new_x.length = stop-start;
-    start=0;
-    while((start<y.length) && (((y.example)[start]).index < from[i])){
-      start++;
-    };
-    //    new_y.example = y.example + start;
-    stop=start;
-    count = 0;
-    while((stop<y.length) && (((y.example)[stop]).index < to[i])){
-      (new_y.example)[count] = (y.example)[stop];
-      ((new_y.example)[count]).index -= from[i]; 
-      count++;
-      stop++;
-    };
-    new_y.length = stop-start;
+    get_part(x,i,new_x);
+    get_part(y,i,new_y);
 
-    // default ist sum-kernel
     result *= (elements[i])->calculate_K(new_x,new_y);
-
   };
+  if(new_x.index != x_buffer) delete [](new_x.index);
+  if(new_y.index != y_buffer) delete [](new_y.index);
   return result;
 };
 
@@ -1499,22 +2641,24 @@ SVMFLOAT kernel_fourier_c::calculate_K(const svm_example x, const svm_example y)
   SVMFLOAT result=1;  
   SVMINT length_x = x.length;
   SVMINT length_y = y.length;
-  svm_attrib* att_x = x.example;
-  svm_attrib* att_y = y.example;
+  SVMFLOAT* att_x = x.att;
+  svm_index* index_x = x.index;
+  SVMFLOAT* att_y = y.att;
+  svm_index* index_y = y.index;
   SVMINT pos_x=0;
   SVMINT pos_y=0;
   SVMINT zeros=dim;
   SVMFLOAT diff;
   SVMFLOAT dummy;
   while((pos_x < length_x) && (pos_y < length_y)){
-    if(att_x[pos_x].index == att_y[pos_y].index){
-      diff = att_x[pos_x++].att-att_y[pos_y++].att;
+    if(index_x[pos_x] == index_y[pos_y]){
+      diff = att_x[pos_x++]-att_y[pos_y++];
     }
-    else if(att_x[pos_x].index < att_y[pos_y].index){
-      diff = att_x[pos_x++].att;
+    else if(index_x[pos_x] < index_y[pos_y]){
+      diff = att_x[pos_x++];
     }
     else{
-      diff = -att_y[pos_y++].att;
+      diff = -att_y[pos_y++];
     };
     dummy = sin(diff/2);
     if(0 == dummy){
@@ -1527,7 +2671,7 @@ SVMFLOAT kernel_fourier_c::calculate_K(const svm_example x, const svm_example y)
     zeros--;
   };
   while(pos_x < length_x){
-    diff = att_x[pos_x++].att;
+    diff = att_x[pos_x++];
     dummy = sin(diff/2);
     if(0 == dummy){
       dummy = 1/2+(SVMFLOAT)N;
@@ -1539,7 +2683,7 @@ SVMFLOAT kernel_fourier_c::calculate_K(const svm_example x, const svm_example y)
     zeros--;
   };
   while(pos_y < length_y){
-    diff = att_y[pos_y++].att;
+    diff = att_y[pos_y++];
     dummy = sin(diff/2);
     if(0 == dummy){
       dummy = 1/2+(SVMFLOAT)N;
@@ -1626,35 +2770,37 @@ SVMFLOAT kernel_reg_fourier_c::calculate_K(const svm_example x, const svm_exampl
   SVMFLOAT result=1;  
   SVMINT length_x = x.length;
   SVMINT length_y = y.length;
-  svm_attrib* att_x = x.example;
-  svm_attrib* att_y = y.example;
+  SVMFLOAT* att_x = x.att;
+  svm_index* index_x = x.index;
+  SVMFLOAT* att_y = y.att;
+  svm_index* index_y = y.index;
   SVMINT pos_x=0;
   SVMINT pos_y=0;
   SVMINT zeros=dim;
   SVMFLOAT diff;
   SVMFLOAT q2 = q*q;
   while((pos_x < length_x) && (pos_y < length_y)){
-    if(att_x[pos_x].index == att_y[pos_y].index){
-      diff = att_x[pos_x++].att-att_y[pos_y++].att;
+    if(index_x[pos_x] == index_y[pos_y]){
+      diff = att_x[pos_x++]-att_y[pos_y++];
     }
-    else if(att_x[pos_x].index < att_y[pos_y].index){
-      diff = att_x[pos_x++].att;
+    else if(index_x[pos_x] < index_y[pos_y]){
+      diff = att_x[pos_x++];
     }
     else{
-      diff = -att_y[pos_y++].att;
+      diff = -att_y[pos_y++];
     };
     diff *= PI;
     result *= (1-q2)/(2*(1-2*q*cos(diff)+q2));
     zeros--;
   };
   while(pos_x < length_x){
-    diff = att_x[pos_x++].att;
+    diff = att_x[pos_x++];
     diff *= PI;
     result *= (1-q2)/(2*(1-2*q*cos(diff)+q2));
     zeros--;
   };
   while(pos_y < length_y){
-    diff = att_y[pos_y++].att;
+    diff = att_y[pos_y++];
     diff *= PI;
     result *= (1-q2)/(2*(1-2*q*cos(diff)+q2));
     zeros--;
@@ -1910,31 +3056,31 @@ void kernel_regularized_c::init(SVMINT new_cache_MB,example_set_c* new_examples)
 };
 
 
-void kernel_regularized_c::compute_row(const SVMINT i, SVMFLOAT* myrow){
-  // place row i in row
+void kernel_regularized_c::compute_row_part(const SVMINT i, SVMFLOAT* myrow, const SVMINT start, const SVMINT stop){
+  // place entries start..stop-1 of row i in row
   svm_example x;
   svm_example y;
-  SVMFLOAT res = cache[i];
+  SVMFLOAT res = cache[active[i]];
   SVMFLOAT res2;
   SVMINT k;
   if(res <= 0){
-    for(k=0;k<examples_size;k++){
+    for(k=start;k<stop;k++){
       myrow[k] = 0;
     };
   }
   else{
-    x = the_examples->get_example(i);
-    for(k=0;k<examples_size;k++){
+    x = the_examples->get_example(active[i]);
+    for(k=start;k<stop;k++){
       if(k == i){
 	myrow[k] = 1;
       }
       else{
-	res2 = cache[k];
+	res2 = cache[active[k]];
 	if(res2 <= 0){
 	  myrow[k] = 0;
 	}
 	else{
-	  y = the_examples->get_example(k);
+	  y = the_examples->get_example(active[k]);
 	  myrow[k] = inner_kernel->calculate_K(x, y)/(res*res2);
 	};
       };
@@ -1943,14 +3089,6 @@ void kernel_regularized_c::compute_row(const SVMINT i, SVMFLOAT* myrow){
 };
 
 
-void kernel_regularized_c::overwrite(const SVMINT i, const SVMINT j){
-  kernel_c::overwrite(i,j);
-  SVMFLOAT tmp = cache[i];
-  cache[i] = cache[j];
-  cache[j] = tmp;
-};
-
-
 SVMFLOAT kernel_regularized_c::calculate_K(const svm_example x, const svm_example y){
   // use caching here!!!
   SVMFLOAT res = inner_kernel->calculate_K(x,x)*inner_kernel->calculate_K(y,y);
@@ -2174,7 +3312,7 @@ void kernel_user2_c::input(istream& data_stream){
 };
 
 void kernel_user2_c::output(ostream& data_stream) const{
-  data_stream<<"type user"<<endl;
+  data_stream<<"type user2"<<endl;
   SVMINT i;
   for(i=0;i<number_param;i++){
     data_stream<<"param_i "<<i<<" "<<param_i[i]<<endl;
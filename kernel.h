@@ -7,28 +7,196 @@
 #include "globals.h"
 #include "example_set.h"
 #include "parameters.h"
+#include "dense.h"
+
+#ifdef use_threads
+#include <pthread.h>
+#endif
 
 /**
  * Base class for all kernels
  * @li kernel caching
  *
+ * The cache holds cache_size rows in slots. slot_of maps an example
+ * to its slot, the slots are kept in a doubly linked list in the order
+ * of their last use, so lookup, hit, miss and eviction take O(1).
+ * All slots live in one 64 byte aligned arena of kernel_cache MB that
+ * is allocated in init(), slot pos starts at arena+pos*row_stride.
+ * With set_cache_float(1) the rows are stored as float, so twice as
+ * many of them fit, and have to be read with get_row_float().
+ *
+ * Rows, columns and calculate_K(i,j) refer to positions, active[pos] is
+ * the example at position pos. The examples themselves never move. To
+ * shrink, the solver permutes get_active() so that the remaining
+ * positions come first and calls set_examples_size(), which gathers the
+ * cached rows into the new order in one pass.
+ *
+ * prefetch() reserves slots for rows that will be needed soon and lets
+ * prefetch_threads background threads compute them. get_row() waits
+ * only if the requested row is still pending. compute_row() splits a
+ * row into parts for kernel_threads threads, subclasses compute a part
+ * in compute_row_part().
+ *
+ * Kernels of the form K(x,y) = f(x*y) or f(||x-y||^2) say so in
+ * get_form() and give f in K_of_dot() or K_of_dist(). If at least
+ * dense_density of the attributes are non-zero, init() then stores the
+ * examples as dense vectors and uses dense_dot() and dense_dist2().
+ * Otherwise ||x||^2 of all examples is stored in norms, so that
+ * ||x-y||^2 = ||x||^2+||y||^2-2*x*y only needs a sparse dot product.
+ * For a whole row, x is scattered once (scatter()), then each x*y only
+ * costs one lookup per attribute of y (gather_dot()).
+ * An example outside the set is prepared once by make_query().
+ * make_rows() copies some examples (e.g. the SVs) into a kernel_rows,
+ * calculate_K_rows() then evaluates the query against them,
+ * calculate_K_rows_block() evaluates several queries. With
+ * set_gemm_rows(1), pack_rows() packs dense rows for dense_gemm(), which
+ * calculate_K_rows_block() then uses for all queries at once.
+ *
  * @author Stefan Rueping <rueping@ls8.cs.uni-dortmund.de>
  * @version 0.1
  **/
 
 
+// row stride of the kernel cache is a multiple of this many bytes
+const SVMINT cache_align = 64;
+// compute_row gives each kernel thread at least this many entries
+const SVMINT min_row_part = 256;
+// aggregation kernels copy up to this many indices on the stack
+const SVMINT aggregation_buffer = 256;
+// store examples as dense vectors if this fraction of attributes is used
+const SVMFLOAT dense_density = 0.5;
+
+// values of kernel_c::get_form()
+const int form_general = 0;
+const int form_dot = 1;  // K(x,y) = K_of_dot(x*y)
+const int form_dist = 2; // K(x,y) = K_of_dist(||x-y||^2)
+
+// examples with more attributes are scattered into a hash table
+const SVMINT scatter_dim = 65536;
+
+// one example scattered for gather_dot(), see kernel_c::scatter()
+typedef struct scattered_example{
+  SVMFLOAT* values;   // values[index] if dim <= scatter_dim, else 0
+  SVMINT* hash_index; // open addressing table of the non-zeros, else 0
+  SVMFLOAT* hash_att;
+  SVMINT hash_mask;   // table size-1, a power of 2 minus 1
+} SCATTERED_EXAMPLE;
+
+// an example outside the set, see kernel_c::make_query()
+typedef struct kernel_query{
+  svm_example x;
+  SVMFLOAT norm;   // ||x||^2, for form_dist
+  SVMFLOAT* dense; // x as dense vector, 0 if the kernel is not dense
+  scattered_example scattered; // x for sparse kernels
+} KERNEL_QUERY;
+
+// copies of some examples, see kernel_c::make_rows()
+typedef struct kernel_rows{
+  SVMINT count;
+  SVMINT* start;    // row k is att[start[k]..start[k+1]-1] at index[..]
+  SVMFLOAT* att;
+  svm_index* index;
+  SVMFLOAT* norms;  // ||row k||^2 for form_dist, else 0
+  char* dense_mem;  // allocated block holding dense
+  SVMFLOAT* dense;  // row k at dense+k*dense_stride if the kernel is dense, else 0
+  SVMINT* order;    // 0..count-1, for dense_dot_rows()
+  char* packed_mem; // allocated block holding packed
+  SVMFLOAT* packed; // dense rows by dense_pack() after pack_rows(), else 0
+} KERNEL_ROWS;
+
+
 class kernel_c{
  protected:
-  SVMINT cache_access;
-  SVMINT cache_misses;
-  SVMINT counter;  // time index for last access
+  cache_stats stats; // only counted #ifdef use_cache_stats
+  void update_resident();
   SVMINT cache_size;  // number of rows in cache
   SVMINT cache_mem;   // max. size of memory for cache
   SVMINT examples_size;  // length of a row
-  SVMFLOAT** rows;
-  SVMINT* last_used; // the heap
-  SVMINT* index;
+  char* arena_mem;     // allocated block holding the arena
+  char* arena;         // rows of all slots, aligned to cache_align
+  SVMINT arena_size;   // size of arena in bytes
+  SVMINT row_stride;   // bytes between two slots, multiple of cache_align
+  SVMINT slot_capacity; // length of index, lru_prev and lru_next
+  int cache_float;     // rows are stored as float
+  SVMFLOAT* row_buffer; // row to be narrowed to float
+  SVMINT* active;      // active[pos] = example at position pos
+  SVMINT* row_active;  // column order of the cached rows
+  SVMFLOAT* diag;      // diag[ex] = K(ex,ex), 0 until first use
+  void compute_diag();
+  SVMFLOAT* norms;     // norms[ex] = ||ex||^2 for form_dist
+  void compute_norms();
+  char* dense_mem;     // allocated block holding dense, 0 if it is the example matrix
+  SVMFLOAT* dense;     // example ex at dense_row(ex), 0 if sparse
+  SVMINT dense_stride; // dim rounded up to dense_block, 0 if sparse
+  int gemm_rows;       // calculate_K_rows_block() uses dense_gemm()
+  void compute_dense();
+  SVMFLOAT* dense_row(const SVMINT ex){ return dense+ex*dense_stride; };
+  void scatter(const svm_example x, scattered_example& sx);
+  void free_scatter(scattered_example& sx);
+  SVMFLOAT gather_dot(const scattered_example& sx, const svm_example y);
+  SVMFLOAT ex_dot(const SVMINT ex_x, const SVMINT ex_y);
+  SVMFLOAT ex_dist2(const SVMINT ex_x, const SVMINT ex_y);
+  SVMFLOAT K_examples(const SVMINT ex_x, const SVMINT ex_y);
+  svm_example row_example(const kernel_rows& rows, const SVMINT k){
+    svm_example x;
+    x.att = rows.att+(rows.start)[k];
+    x.index = rows.index+(rows.start)[k];
+    x.length = (rows.start)[k+1]-(rows.start)[k];
+    return x;
+  };
+  void complete_rows(kernel_rows& rows);
+  void rows_inner(const kernel_rows& rows, const SVMINT from, const SVMINT to, const kernel_query& query, SVMFLOAT* result);
+  SVMINT* index;    // index[slot] = example in slot, -1 if slot is free
+  SVMINT* slot_of;  // slot_of[i] = slot of row i, -1 if not cached
+  SVMINT* lru_prev; // LRU list over the slots, head = most recently used
+  SVMINT* lru_next;
+  SVMINT lru_head;
+  SVMINT lru_tail;
   void clean_cache();
+  void free_arena();
+  SVMINT entry_size(){ return(cache_float ? sizeof(float) : sizeof(SVMFLOAT)); };
+  SVMINT padded(const SVMINT n){ return ((n*entry_size()+cache_align-1)/cache_align)*cache_align; };
+  char* row_at(const SVMINT pos){ return arena+pos*row_stride; };
+  SVMINT fetch_row(const SVMINT i);
+  void lru_unlink(const SVMINT pos);
+  void lru_push_front(const SVMINT pos);
+  void lru_push_back(const SVMINT pos);
+
+  SVMINT prefetch_threads;
+#ifdef use_threads
+  pthread_t* prefetch_pool; // 0 until the first prefetch()
+  pthread_mutex_t prefetch_mutex;
+  pthread_cond_t prefetch_work;
+  pthread_cond_t prefetch_done;
+  SVMINT* prefetch_slot; // slots whose rows are to be computed
+  SVMINT prefetch_size;  // length of prefetch_slot
+  SVMINT prefetch_count;
+  SVMINT prefetch_next;
+  SVMINT prefetch_running;
+  int prefetch_quit;
+  char* slot_pending; // 1 while the row of a slot is computed
+  void start_prefetch();
+  void stop_prefetch();
+  void wait_slot(const SVMINT pos);
+  static void* prefetch_worker(void* the_kernel);
+#endif
+
+  SVMINT kernel_threads;
+#ifdef use_threads
+  pthread_t* row_pool; // kernel_threads-1 threads, 0 until needed
+  pthread_mutex_t row_mutex;
+  pthread_cond_t row_work;
+  pthread_cond_t row_done;
+  SVMINT row_job_i;
+  SVMFLOAT* row_job;
+  SVMINT row_parts;
+  SVMINT row_next_part;
+  SVMINT row_parts_left;
+  int row_quit;
+  void start_row_pool();
+  void stop_row_pool();
+  static void* row_worker(void* the_kernel);
+#endif
 
   // little helpers
   SVMFLOAT innerproduct(const svm_example x, const svm_example y);
@@ -47,30 +215,90 @@ class kernel_c{
   virtual ~kernel_c();
   virtual void init(SVMINT new_cache_MB,example_set_c* new_examples);
   void set_examples_size(SVMINT new_examples_size);
+  SVMINT* get_active(){ wait_prefetch(); return active; };
+  cache_stats get_cache_stats();
+  void clear_cache_stats();
+  SVMFLOAT get_diag(const SVMINT i){ // K(i,i) of position i
+    if(0 == diag) compute_diag();
+    return diag[active[i]];
+  };
+  void reset_active();
   int cached(const SVMINT i);
   int check();
-  virtual void overwrite(const SVMINT i, const SVMINT j);
-  SVMINT lookup(const SVMINT i);
+  SVMINT lookup(const SVMINT i); // slot of row i, cache_size if not cached
   virtual SVMFLOAT calculate_K(const SVMINT i, const SVMINT j);
   virtual SVMFLOAT calculate_K(const svm_example x, const svm_example y);
+  virtual int get_form(){ return form_general; };
+  virtual SVMFLOAT K_of_dot(const SVMFLOAT s){ return s; };
+  virtual SVMFLOAT K_of_dist(const SVMFLOAT d){ return d; };
+  virtual int is_linear(){ return 0; }; // K_of_dot(s) = a*s+b?
+  int is_dense(){ return (0 != dense); };
+  void free_tables(); // drop dense rows and norms
+  SVMINT w_size(){ return((0 != dense) ? dense_stride : dim); };
+  // result[p-from] = w*x of position p, w has w_size() entries
+  void dot_positions(const SVMFLOAT* w, const SVMINT from, const SVMINT to, SVMFLOAT* result);
+  void make_query(const svm_example x, kernel_query& query);
+  void free_query(kernel_query& query);
+  SVMFLOAT calculate_K_query(const SVMINT ex, const kernel_query& query); // K(example ex,query)
+  // result[k] = K(example ex[k],query)
+  virtual void calculate_K_batch(const SVMINT* ex, const SVMINT count, const kernel_query& query, SVMFLOAT* result);
+  void make_rows(const SVMINT* ex, const SVMINT count, kernel_rows& rows); // copy examples ex[0..count-1]
+  virtual void init_rows(const SVMINT new_dim, kernel_rows& rows); // rows read from a file, no init() needed
+  void pack_rows(kernel_rows& rows); // if set_gemm_rows(1) and the rows are dense
+  void free_rows(kernel_rows& rows);
+  // result[k-from] = K(row k,query) for from <= k < to
+  virtual void calculate_K_rows(const kernel_rows& rows, const SVMINT from, const SVMINT to, const kernel_query& query, SVMFLOAT* result);
+  // result[q*(to-from)+k-from] = K(row k,queries[q]) for q < count
+  virtual void calculate_K_rows_block(const kernel_rows& rows, const SVMINT from, const SVMINT to, const kernel_query* queries, const SVMINT count, SVMFLOAT* result);
+  void set_gemm_rows(const int use_gemm);
+  void set_cache_float(const int use_float); // call before init()
+  int is_cache_float(){ return cache_float; };
+  int fits_in_cache(const SVMINT n){ return(arena_size >= n*padded(n)); }; // all n rows?
+  void set_prefetch_threads(const SVMINT threads);
+  void set_kernel_threads(const SVMINT threads);
+  void prefetch(const SVMINT* rows, const SVMINT count);
+  void wait_prefetch();
+  virtual int is_reentrant(){ return 1; }; // may calculate_K run in parallel?
   SVMFLOAT* get_row(const SVMINT i); // returned pointer will not be manipulated
-  virtual void compute_row(const SVMINT i, SVMFLOAT* row);
+  float* get_row_float(const SVMINT i); // same for float cache
+  void compute_row(const SVMINT i, SVMFLOAT* row);
+  virtual void compute_row_part(const SVMINT i, SVMFLOAT* row, const SVMINT start, const SVMINT stop);
 };
 
 istream& operator >> (istream& data_stream, kernel_c& the_kernel);
 ostream& operator << (ostream& data_stream, kernel_c& the_kernel);
 
 
-class kernel_dot_c : public kernel_c{
+/**
+ * Row and batch loops for the kernel class Kernel derived from it.
+ * They call K_of_dot(), K_of_dist() or calculate_K(x,y) of Kernel
+ * directly, so these can be inlined, and dispatch only once per row
+ * part or batch. Instantiated in kernel.cpp.
+ **/
+template<class Kernel>
+class kernel_row_engine : public kernel_c{
+ public:
+  virtual void compute_row_part(const SVMINT i, SVMFLOAT* row, const SVMINT start, const SVMINT stop);
+  virtual void calculate_K_batch(const SVMINT* ex, const SVMINT count, const kernel_query& query, SVMFLOAT* result);
+  virtual void calculate_K_rows(const kernel_rows& rows, const SVMINT from, const SVMINT to, const kernel_query& query, SVMFLOAT* result);
+  virtual void calculate_K_rows_block(const kernel_rows& rows, const SVMINT from, const SVMINT to, const kernel_query* queries, const SVMINT count, SVMFLOAT* result);
+  void K_of_dist_block(SVMFLOAT* d, const SVMINT n); // d[k] = K_of_dist(d[k])
+};
+
+
+class kernel_dot_c : public kernel_row_engine<kernel_dot_c>{
  public:
   kernel_dot_c(){};
   virtual void input(istream& data_stream);
   virtual void output(ostream& data_stream) const;
   virtual SVMFLOAT calculate_K(const svm_example x, const svm_example y);
+  virtual int get_form(){ return form_dot; };
+  virtual SVMFLOAT K_of_dot(const SVMFLOAT s){ return s; };
+  virtual int is_linear(){ return 1; };
 };
 
 
-class kernel_lin_dot_c : public kernel_c{
+class kernel_lin_dot_c : public kernel_row_engine<kernel_lin_dot_c>{
  protected:
   SVMFLOAT a;
   SVMFLOAT b;
@@ -79,10 +307,13 @@ class kernel_lin_dot_c : public kernel_c{
   virtual void input(istream& data_stream);
   virtual void output(ostream& data_stream) const;
   virtual SVMFLOAT calculate_K(const svm_example x, const svm_example y);
+  virtual int get_form(){ return form_dot; };
+  virtual SVMFLOAT K_of_dot(const SVMFLOAT s){ return a*s+b; };
+  virtual int is_linear(){ return 1; };
 };
 
 
-class kernel_polynomial_c : public kernel_c{
+class kernel_polynomial_c : public kernel_row_engine<kernel_polynomial_c>{
  protected:
   SVMINT degree;
  public:
@@ -90,10 +321,12 @@ class kernel_polynomial_c : public kernel_c{
   virtual void input(istream& data_stream);
   virtual void output(ostream& data_stream) const;
   virtual SVMFLOAT calculate_K(const svm_example x, const svm_example y);
+  virtual int get_form(){ return form_dot; };
+  virtual SVMFLOAT K_of_dot(const SVMFLOAT s);
 };
 
 
-class kernel_radial_c : public kernel_c{
+class kernel_radial_c : public kernel_row_engine<kernel_radial_c>{
  protected:
   SVMFLOAT gamma;
  public:
@@ -101,10 +334,13 @@ class kernel_radial_c : public kernel_c{
   virtual void input(istream& data_stream);
   virtual void output(ostream& data_stream) const;
   virtual SVMFLOAT calculate_K(const svm_example x, const svm_example y);
+  virtual int get_form(){ return form_dist; };
+  virtual SVMFLOAT K_of_dist(const SVMFLOAT d){ return exp(-gamma*d); };
+  void K_of_dist_block(SVMFLOAT* d, const SVMINT n); // by dense_exp()
 };
 
 
-class kernel_neural_c : public kernel_c{
+class kernel_neural_c : public kernel_row_engine<kernel_neural_c>{
  protected:
   SVMFLOAT a,b;
  public:
@@ -112,10 +348,12 @@ class kernel_neural_c : public kernel_c{
   virtual void input(istream& data_stream);
   virtual void output(ostream& data_stream) const;
   virtual SVMFLOAT calculate_K(const svm_example x, const svm_example y);
+  virtual int get_form(){ return form_dot; };
+  virtual SVMFLOAT K_of_dot(const SVMFLOAT s){ return tanh(a*s+b); };
 };
 
 
-class kernel_anova_c : public kernel_c{
+class kernel_anova_c : public kernel_row_engine<kernel_anova_c>{
  protected:
   SVMINT degree;
   SVMFLOAT gamma;
@@ -203,6 +441,7 @@ class kernel_lintransform_c : public kernel_c{
   ~kernel_lintransform_c();
   void input(istream& data_stream);
   void output(ostream& data_stream) const;
+  virtual int is_reentrant(){ return subkernel->is_reentrant(); };
   virtual SVMFLOAT calculate_K(const svm_example x, const svm_example y);
 
 };
@@ -233,6 +472,7 @@ class kernel_discrete_subseq_c : public kernel_c{
   virtual SVMFLOAT calculate_inner_K(const SVMINT size, const SVMINT end_x, const SVMINT end_y);
   virtual SVMFLOAT calculate_inner_K_prime(const SVMINT size, const SVMINT end_x, const SVMINT end_y);
  public:
+  virtual int is_reentrant(){ return 0; };
   kernel_discrete_subseq_c();
   ~kernel_discrete_subseq_c();
   virtual void input(istream& data_stream);
@@ -250,10 +490,10 @@ class kernel_regularized_c : public kernel_c{
   ~kernel_regularized_c();
   void input(istream& data_stream);
   void output(ostream& data_stream) const;
+  virtual int is_reentrant(){ return inner_kernel->is_reentrant(); };
   virtual SVMFLOAT calculate_K(const svm_example x, const svm_example y);
-  virtual void compute_row(const SVMINT i, SVMFLOAT* row);
+  virtual void compute_row_part(const SVMINT i, SVMFLOAT* row, const SVMINT start, const SVMINT stop);
   virtual void init(SVMINT new_cache_MB,example_set_c* new_examples);
-  virtual void overwrite(const SVMINT i, const SVMINT j);
 };
 
 
@@ -268,11 +508,10 @@ class kernel_complete_matrix_c : public kernel_c{
   ~kernel_complete_matrix_c();
   void input(istream& data_stream);
   void output(ostream& data_stream) const;
-  virtual void compute_row(const SVMINT i, SVMFLOAT* myrow);
+  virtual void compute_row_part(const SVMINT i, SVMFLOAT* myrow, const SVMINT start, const SVMINT stop);
   virtual SVMFLOAT calculate_K(const SVMINT i, const SVMINT j);
   virtual SVMFLOAT calculate_K(const svm_example x, const svm_example y);
   virtual void init(SVMINT new_cache_MB,example_set_c* new_examples);
-  virtual void overwrite(const SVMINT i, const SVMINT j);
 };
 
 
@@ -282,14 +521,16 @@ class kernel_aggregation_c : public kernel_c{
   kernel_c** elements;
   SVMINT* from;
   SVMINT* to;
-  svm_example new_x, new_y;
+  SVMINT get_part(const svm_example x, const SVMINT i, svm_example& part);
  public:
   kernel_aggregation_c();
   ~kernel_aggregation_c();
   virtual void init(SVMINT new_cache_MB,example_set_c* new_examples);
+  virtual void init_rows(const SVMINT new_dim, kernel_rows& rows);
   void input(istream& data_stream);
   void output(ostream& data_stream) const;
   void output_aggregation(ostream& data_stream) const;
+  virtual int is_reentrant();
   virtual SVMFLOAT calculate_K(const svm_example x, const svm_example y);
 };
 
@@ -34,7 +34,8 @@ void print_help(){
   cout<<"my_svm: train a svm from the given parameters and examples."<<endl<<endl;
   cout<<"usage: my_svm"<<endl
       <<"       my_svm <FILE>"<<endl
-      <<"       my_svm <FILE1> <FILE2> ..."<<endl<<endl;
+      <<"       my_svm <FILE1> <FILE2> ..."<<endl
+      <<"       my_svm -convert <FILE1> <FILE2> ..."<<endl<<endl;
   cout<<"The input has to consist of:"<<endl
       <<"- the svm parameters"<<endl
       <<"- the kernel definition"<<endl
@@ -43,6 +44,8 @@ void print_help(){
 
   cout<<endl<<"See the documentation for the input format. The first example set to be entered is considered to be the training set, all others are test sets. Each input file can consist of one or more definitions. If no input file is specified, the input is read from <stdin>."<<endl<<endl;
 
+  cout<<"With -convert, each example set is written to <FILE>.bin in a binary format, the training set scaled as for training, the test sets unscaled. Such a file can take the place of the example set in any input, it is mapped into memory instead of being read."<<endl<<endl;
+
   cout<<endl<<"This software is free only for non-commercial use. It must not be modified and distributed without prior permission of the author. The author is not responsible for implications from the use of this software."<<endl;
   exit(0);
 };
@@ -91,7 +94,7 @@ void read_input(istream& input_stream, char* filename){
 	  if(0 != parameters){
 	    training_set->set_format(parameters->default_example_format);
 	  };
-	  input_stream >> *training_set;	    
+	  read_examples(input_stream,filename,*training_set);
 	  training_set->set_filename(filename);
 	  cout<<"   read "<<training_set->size()<<" examples, format "<<training_set->my_format<<", dimension = "<<training_set->get_dim()<<"."<<endl;
 	}
@@ -102,7 +105,7 @@ void read_input(istream& input_stream, char* filename){
 	  if(0 != parameters){
 	    (test_set->the_set)->set_format(parameters->default_example_format);
 	  };
-	  input_stream >> *(test_set->the_set);
+	  read_examples(input_stream,filename,*(test_set->the_set));
 	  (test_set->the_set)->set_filename(filename);
 	  test_set->next = test_sets;
 	  test_sets = test_set;
@@ -130,7 +133,7 @@ void read_input(istream& input_stream, char* filename){
 	if(0 != parameters){
 	  training_set->set_format(parameters->default_example_format);
 	};
-	input_stream  >> *training_set;	    
+	read_examples(input_stream,filename,*training_set);
 	training_set->set_filename(filename);
 	cout<<"   read "<<training_set->size()<<" examples, format "<<training_set->my_format<<", dimension = "<<training_set->get_dim()<<"."<<endl;
       }
@@ -141,7 +144,7 @@ void read_input(istream& input_stream, char* filename){
 	if(0 != parameters){
 	  (test_set->the_set)->set_format(parameters->default_example_format);
 	};
-	input_stream >> *(test_set->the_set);
+	read_examples(input_stream,filename,*(test_set->the_set));
 	(test_set->the_set)->set_filename(filename);
 	test_set->next = test_sets;
 	test_sets = test_set;
@@ -158,6 +161,62 @@ void read_input(istream& input_stream, char* filename){
 };
 
 
+void read_example_file(char* filename){
+  // a binary example set file
+  example_set_c* the_set = new example_set_c();
+  the_set->load(filename);
+  the_set->set_filename(filename);
+  if(0 == training_set){
+    training_set = the_set;
+  }
+  else{
+    example_set_list* test_set = new example_set_list;
+    test_set->the_set = the_set;
+    test_set->next = test_sets;
+    test_sets = test_set;
+  };
+  cout<<"   mapped "<<the_set->size()<<" examples, format "<<the_set->my_format<<", dimension = "<<the_set->get_dim()<<"."<<endl;
+};
+
+
+void convert_sets(){
+  // write the sets as binary files, the training set scaled as mysvm
+  // would scale it. test sets stay unscaled, they are scaled by the
+  // training set they are used with
+  char* outname = new char[MAXCHAR];
+  example_set_c* the_set = training_set;
+  example_set_list* next_set = test_sets;
+  if(parameters->do_scale && (! training_set->initialised_scale())){
+    training_set->scale(parameters->do_scale_y);
+  };
+  while(0 != the_set){
+    strcpy(outname,the_set->get_filename());
+    strcat(outname,".bin");
+    cout<<"Writing "<<outname<<endl;
+    ofstream output_file(outname,ios::out|ios::trunc|ios::binary);
+    if(! output_file){
+      cout<<"*** ERROR: Could not write file "<<outname<<endl;
+      exit(1);
+    };
+    the_set->my_format.binary = 1;
+    output_file<<(*the_set);
+    output_file.close();
+    if(! output_file){
+      cout<<"*** ERROR: Could not write file "<<outname<<" completely"<<endl;
+      exit(1);
+    };
+    if(0 != next_set){
+      the_set = next_set->the_set;
+      next_set = next_set->next;
+    }
+    else{
+      the_set = 0;
+    };
+  };
+  delete []outname;
+};
+
+
 svm_result do_cv(){
   SVMINT number = parameters->cross_validation;
   SVMINT size = training_set->size();
@@ -264,6 +323,10 @@ svm_result do_cv(){
     if(verbosity>=4){
       cout<<"Setting up the SVM"<<endl;
     };
+    kernel->set_cache_float(parameters->kernel_cache_float);
+    kernel->set_prefetch_threads(parameters->prefetch_threads);
+    kernel->set_kernel_threads(parameters->kernel_threads);
+    kernel->set_gemm_rows(parameters->gemm_prediction);
     kernel->init(parameters->kernel_cache,cv_train);
     svm->init(kernel,parameters);
 
@@ -390,6 +453,10 @@ svm_result train(){
     the_result = do_cv();
   }
   else{
+    kernel->set_cache_float(parameters->kernel_cache_float);
+    kernel->set_prefetch_threads(parameters->prefetch_threads);
+    kernel->set_kernel_threads(parameters->kernel_threads);
+    kernel->set_gemm_rows(parameters->gemm_prediction);
     kernel->init(parameters->kernel_cache,training_set);
     svm->init(kernel,parameters);
 
@@ -601,6 +668,7 @@ svm_result calc_c(){
 int main(int argc,char* argv[]){
   cout<<"*** mySVM version "<<mysvmversion<<" ***"<<endl;
   cout.precision(8);
+  int convert = 0;
   // read objects
   try{
     if(argc<2){
@@ -617,11 +685,18 @@ int main(int argc,char* argv[]){
       else{
 	// read in all input files
 	for(int i=1;i<argc;i++){
-	  if(0 == strcmp(argv[i],"-")){
+	  if((1 == i) && (0 == strcmp(argv[i],"-convert"))){
+	    convert = 1;
+	  }
+	  else if(0 == strcmp(argv[i],"-")){
 	    cout<<"Reading from STDIN"<<endl;
 	    // read vom cin
 	    read_input(cin,"mysvm");
 	  }
+	  else if(example_set_c::is_example_file(argv[i])){
+	    cout<<"Reading "<<argv[i]<<endl;
+	    read_example_file(argv[i]);
+	  }
 	  else{
 	    cout<<"Reading "<<argv[i]<<endl;
 	    ifstream input_file(argv[i]);
@@ -645,6 +720,10 @@ int main(int argc,char* argv[]){
     exit(1);
   };
 
+  if(0 == training_set){
+    cout << "*** ERROR: You did not enter the training set"<<endl;
+    exit(1);
+  };
   if(0 == parameters){
     parameters = new parameters_c();
     if(training_set->initialised_pattern_y()){
@@ -653,13 +732,19 @@ int main(int argc,char* argv[]){
     };
   };
   parameters->is_linear = is_linear;
+  if(convert){
+    try{
+      convert_sets();
+    }
+    catch(general_exception &the_ex){
+      cout<<"*** Error while converting: "<<the_ex.error_msg<<endl;
+      exit(1);
+    };
+    return(0);
+  };
   if(0 == kernel){
     kernel = new kernel_dot_c();
   };
-  if(0 == training_set){
-    cout << "*** ERROR: You did not enter the training set"<<endl;
-    exit(1);
-  };
   if(2 > training_set->size()){
     cout << "*** ERROR: Need at least two examples to learn."<<endl;
     exit(1);
@@ -694,8 +779,8 @@ int main(int argc,char* argv[]){
     cout<<"RSVM generated"<<endl;
   };
 
-  // scale examples
-  if(parameters->do_scale){
+  // scale examples, unless they are from a scaled binary file
+  if(parameters->do_scale && (! training_set->initialised_scale())){
     training_set->scale(parameters->do_scale_y);
   };
 
@@ -721,10 +806,38 @@ int main(int argc,char* argv[]){
     char* outname = new char[MAXCHAR];
     strcpy(outname,training_set->get_filename());
     strcat(outname,".svm");
-    ofstream output_file(outname,ios::out|ios::trunc);
-    output_file.precision(16);
-    output_file<<*training_set;
-    output_file.close();
+    hyperplane_c* the_hyperplane = 0;
+    if(parameters->save_w){
+      the_hyperplane = svm->get_hyperplane();
+      if((0 == the_hyperplane) && (parameters->verbosity > 0)){
+	cout<<"WARNING: save_w needs a linear kernel, saving SVs"<<endl;
+      };
+    };
+    if(0 != the_hyperplane){
+      ofstream output_file(outname,ios::out|ios::trunc);
+      output_file.precision(16);
+      output_file<<"@hyperplane"<<endl;
+      output_file<<*the_hyperplane;
+      output_file.close();
+      delete the_hyperplane;
+    }
+    else if(parameters->binary_model){
+      if(! svm->save_model(outname)){
+	exit(1);
+      };
+    }
+    else if(training_set->my_format.binary){
+      // a binary training set, predict maps its SVs as well
+      ofstream output_file(outname,ios::out|ios::trunc|ios::binary);
+      output_file<<*training_set;
+      output_file.close();
+    }
+    else{
+      ofstream output_file(outname,ios::out|ios::trunc);
+      output_file.precision(16);
+      output_file<<*training_set;
+      output_file.close();
+    };
     delete []outname;
   };
 
@@ -744,7 +857,17 @@ int main(int argc,char* argv[]){
     while(test_sets != 0){
       test_no++;
       next_test = test_sets->the_set;
-      if(parameters->do_scale){
+      if(next_test->initialised_scale()){
+	// from a binary file, it has to be scaled like the training set
+	if(! next_test->scaled_by(training_set->get_exp(),
+				  training_set->get_var(),
+				  training_set->get_dim())){
+	  cout<<"*** ERROR: "<<(next_test->get_filename())<<" was not scaled like the training set, skipping it"<<endl;
+	  test_sets = test_sets->next;
+	  continue;
+	};
+      }
+      else if(training_set->initialised_scale()){
 	next_test->scale(training_set->get_exp(),
 			 training_set->get_var(),
 			 training_set->get_dim());
@@ -762,6 +885,8 @@ int main(int argc,char* argv[]){
 	strcat(outname,".pred");
 	ofstream output_file(outname,ios::out);
 	output_file<<"@examples"<<endl;
+	// predictions are text, also for a binary test set
+	next_test->my_format.binary = 0;
 	output_file<<(*next_test);
 	output_file.close();	
       };
@@ -0,0 +1,384 @@
+#include "model.h"
+#include <fstream.h>
+#include <strstream.h>
+
+#ifdef use_mmap
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+
+sv_model_c::sv_model_c(){
+  file_mem = 0;
+  file_size = 0;
+  file_mapped = 0;
+  count = 0;
+  alphas = 0;
+  rows.count = 0;
+  rows.start = 0;
+  rows.att = 0;
+  rows.index = 0;
+  rows.norms = 0;
+  rows.dense_mem = 0;
+  rows.dense = 0;
+  rows.packed_mem = 0;
+  rows.packed = 0;
+  rows.order = 0;
+  b = 0;
+  dim = 0;
+  Exp = 0;
+  Var = 0;
+  is_pattern = -1;
+  sparse = -1;
+  delimiter = ' ';
+  kernel = 0;
+};
+
+
+sv_model_c::~sv_model_c(){
+  clear();
+};
+
+
+void sv_model_c::clear(){
+  if(0 != file_mem){
+    // arrays are part of the file
+    rows.start = 0;
+    rows.att = 0;
+    rows.index = 0;
+#ifdef use_mmap
+    if(file_mapped){
+      munmap(file_mem,file_size);
+    }
+    else{
+      delete []file_mem;
+    };
+#else
+    delete []file_mem;
+#endif
+  }
+  else{
+    if(0 != alphas) delete []alphas;
+    if(0 != Exp) delete []Exp;
+    if(0 != Var) delete []Var;
+  };
+  if(0 != kernel) kernel->free_rows(rows);
+  file_mem = 0;
+  file_size = 0;
+  file_mapped = 0;
+  alphas = 0;
+  Exp = 0;
+  Var = 0;
+  kernel = 0;
+  count = 0;
+};
+
+
+void sv_model_c::init(example_set_c* examples, kernel_c* new_kernel){
+  // new_kernel was initialised with examples
+  take_svs(examples,new_kernel,1);
+};
+
+
+void sv_model_c::read_svs(example_set_c* examples, kernel_c* new_kernel){
+  // new_kernel needs no init() and no cache
+  take_svs(examples,new_kernel,0);
+};
+
+
+void sv_model_c::take_svs(example_set_c* examples, kernel_c* new_kernel, const int kernel_has_examples){
+  clear();
+  SVMINT n = examples->size();
+  SVMINT* ex = new SVMINT[n+1];
+  SVMINT i;
+  SVMINT j;
+  for(i=0;i<n;i++){
+    if(examples->get_alpha(i) != 0){
+      ex[count] = i;
+      count++;
+    };
+  };
+  alphas = new SVMFLOAT[count];
+  for(i=0;i<count;i++){
+    alphas[i] = examples->get_alpha(ex[i]);
+  };
+  b = examples->get_b();
+  dim = examples->get_dim();
+  if(count > 0){
+    kernel = new_kernel;
+    if(kernel_has_examples){
+      kernel->make_rows(ex,count,rows);
+    }
+    else{
+      // copy the SVs here, the kernel only adds its tables
+      svm_example x;
+      SVMINT length = 0;
+      rows.count = count;
+      rows.start = new SVMINT[count+1];
+      for(i=0;i<count;i++){
+	(rows.start)[i] = length;
+	length += (examples->get_example(ex[i])).length;
+      };
+      (rows.start)[count] = length;
+      rows.att = new SVMFLOAT[length];
+      rows.index = new svm_index[length];
+      for(i=0;i<count;i++){
+	x = examples->get_example(ex[i]);
+	for(j=0;j<x.length;j++){
+	  (rows.att)[(rows.start)[i]+j] = (x.att)[j];
+	  (rows.index)[(rows.start)[i]+j] = (x.index)[j];
+	};
+      };
+      kernel->init_rows(dim,rows);
+    };
+  };
+  delete []ex;
+  if(examples->initialised_scale()){
+    Exp = new SVMFLOAT[dim+1];
+    Var = new SVMFLOAT[dim+1];
+    for(i=0;i<=dim;i++){
+      Exp[i] = (examples->get_exp())[i];
+      Var[i] = (examples->get_var())[i];
+    };
+  };
+};
+
+
+SVMFLOAT sv_model_c::unscale_y(const SVMFLOAT scaled_y){
+  // as example_set_c::unscale_y() of the training set
+  if((0 == Exp) || (0 == Var)){
+    return scaled_y;
+  }
+  else if(0 == Var[dim]){
+    return scaled_y+Exp[dim];
+  }
+  else{
+    return (scaled_y*Var[dim]+Exp[dim]);
+  };
+};
+
+
+static void write_padded(ostream& data_stream, const char* data, const SVMINT length){
+  // data, then zeros up to the next multiple of model_align
+  static const char zeros[model_align] = {0};
+  if(length > 0){
+    data_stream.write(data,length);
+  };
+  if(length % model_align != 0){
+    data_stream.write(zeros,model_align-length%model_align);
+  };
+};
+
+
+static SVMINT padded_length(const SVMINT length){
+  return ((length+model_align-1)/model_align)*model_align;
+};
+
+
+int sv_model_c::save(const char* filename){
+  // kernel definition as text, as in the input files
+  ostrstream kernel_text;
+  kernel_text.precision(17);
+  if(0 != kernel){
+    kernel_text << *kernel;
+  }
+  else{
+    kernel_text << "type dot" << endl;
+  };
+
+  model_header header;
+  memset(&header,0,sizeof(header));
+  memcpy(header.magic,model_magic,8);
+  header.version = model_version;
+  header.size_int = sizeof(SVMINT);
+  header.size_float = sizeof(SVMFLOAT);
+  header.size_index = sizeof(svm_index);
+  header.count = count;
+  header.dim = dim;
+  header.nnz = (count > 0) ? (rows.start)[count] : 0;
+  header.kernel_length = kernel_text.pcount();
+  header.scaled = ((0 != Exp) && (0 != Var));
+  header.is_pattern = is_pattern;
+  header.sparse = sparse;
+  header.delimiter = delimiter;
+  header.b = b;
+
+  ofstream output_file(filename,ios::out|ios::trunc|ios::binary);
+  if(! output_file){
+    cout<<"*** ERROR: Could not write model file "<<filename<<endl;
+    return 0;
+  };
+  write_padded(output_file,(const char*)&header,sizeof(header));
+  write_padded(output_file,kernel_text.str(),header.kernel_length);
+  kernel_text.freeze(0);
+  if(header.scaled){
+    write_padded(output_file,(const char*)Exp,(dim+1)*sizeof(SVMFLOAT));
+    write_padded(output_file,(const char*)Var,(dim+1)*sizeof(SVMFLOAT));
+  };
+  write_padded(output_file,(const char*)alphas,count*sizeof(SVMFLOAT));
+  if(count > 0){
+    write_padded(output_file,(const char*)rows.start,(count+1)*sizeof(SVMINT));
+    write_padded(output_file,(const char*)rows.att,header.nnz*sizeof(SVMFLOAT));
+    write_padded(output_file,(const char*)rows.index,header.nnz*sizeof(svm_index));
+  };
+  output_file.close();
+  if(! output_file){
+    cout<<"*** ERROR: Could not write model file "<<filename<<" completely"<<endl;
+    return 0;
+  };
+  return 1;
+};
+
+
+int sv_model_c::is_model_file(const char* filename){
+  char magic[8];
+  ifstream input_file(filename,ios::in|ios::binary);
+  if(input_file.bad()){
+    return 0;
+  };
+  input_file.read(magic,8);
+  if(input_file.gcount() != 8){
+    return 0;
+  };
+  return(0 == memcmp(magic,model_magic,8));
+};
+
+
+kernel_c* sv_model_c::load(const char* filename){
+  clear();
+#ifdef use_mmap
+  int fd = open(filename,O_RDONLY);
+  if(fd < 0){
+    throw read_exception("Could not open model file");
+  };
+  struct stat file_stat;
+  if(0 != fstat(fd,&file_stat)){
+    close(fd);
+    throw read_exception("Could not open model file");
+  };
+  file_size = file_stat.st_size;
+  void* mapped = MAP_FAILED;
+  if(file_size > 0){
+    mapped = mmap(0,file_size,PROT_READ,MAP_PRIVATE,fd,0);
+  };
+  close(fd);
+  if(MAP_FAILED == mapped){
+    file_size = 0;
+    throw read_exception("Could not map model file");
+  };
+  file_mem = (char*)mapped;
+  file_mapped = 1;
+#else
+  ifstream input_file(filename,ios::in|ios::binary);
+  if(input_file.bad()){
+    throw read_exception("Could not open model file");
+  };
+  input_file.seekg(0,ios::end);
+  file_size = input_file.tellg();
+  input_file.seekg(0,ios::beg);
+  file_mem = new char[file_size+1];
+  input_file.read(file_mem,file_size);
+  if(input_file.gcount() != file_size){
+    throw read_exception("Could not read model file");
+  };
+#endif
+
+  // check the header
+  if(file_size < (SVMINT)sizeof(model_header)){
+    throw read_exception("Model file is too short");
+  };
+  model_header* header = (model_header*)file_mem;
+  if(0 != memcmp(header->magic,model_magic,8)){
+    throw read_exception("Not a model file");
+  };
+  if(header->version != model_version){
+    throw read_exception("Model file has a different version (or byte order)");
+  };
+  if((header->size_int != (SVMINT)sizeof(SVMINT)) ||
+     (header->size_float != (SVMINT)sizeof(SVMFLOAT)) ||
+     (header->size_index != (SVMINT)sizeof(svm_index))){
+    throw read_exception("Model file was written with different number types");
+  };
+  // no array may be longer than the file, so the sizes cannot overflow
+  if((header->count < 0) || (header->dim < 0) || (header->nnz < 0) ||
+     (header->kernel_length < 0) || (header->dim >= MAXSVMINDEX) ||
+     (header->count >= file_size/(SVMINT)sizeof(SVMINT)) ||
+     (header->nnz > file_size/(SVMINT)sizeof(SVMFLOAT)) ||
+     (header->nnz > file_size/(SVMINT)sizeof(svm_index)) ||
+     (header->kernel_length > file_size) ||
+     (header->scaled && (header->dim >= file_size/(SVMINT)sizeof(SVMFLOAT)))){
+    throw read_exception("Model file is damaged");
+  };
+
+  // find the arrays
+  SVMINT pos = padded_length(sizeof(model_header));
+  SVMINT kernel_pos = pos;
+  pos += padded_length(header->kernel_length);
+  SVMINT exp_pos = pos;
+  if(header->scaled){
+    pos += 2*padded_length((header->dim+1)*sizeof(SVMFLOAT));
+  };
+  SVMINT alphas_pos = pos;
+  pos += padded_length(header->count*sizeof(SVMFLOAT));
+  SVMINT start_pos = pos;
+  SVMINT att_pos = pos;
+  SVMINT index_pos = pos;
+  if(header->count > 0){
+    pos += padded_length((header->count+1)*sizeof(SVMINT));
+    att_pos = pos;
+    pos += padded_length(header->nnz*sizeof(SVMFLOAT));
+    index_pos = pos;
+    pos += padded_length(header->nnz*sizeof(svm_index));
+  };
+  if(pos > file_size){
+    throw read_exception("Model file is too short");
+  };
+
+  count = header->count;
+  dim = header->dim;
+  b = header->b;
+  is_pattern = header->is_pattern;
+  sparse = header->sparse;
+  delimiter = (char)header->delimiter;
+  alphas = (SVMFLOAT*)(file_mem+alphas_pos);
+  if(header->scaled){
+    Exp = (SVMFLOAT*)(file_mem+exp_pos);
+    Var = (SVMFLOAT*)(file_mem+exp_pos+padded_length((dim+1)*sizeof(SVMFLOAT)));
+  };
+
+  // the kernel
+  istrstream kernel_stream(file_mem+kernel_pos,header->kernel_length);
+  kernel_container_c k_cont;
+  kernel_stream >> k_cont;
+  kernel_c* the_kernel = k_cont.get_kernel();
+
+  rows.count = count;
+  if(count > 0){
+    rows.start = (SVMINT*)(file_mem+start_pos);
+    rows.att = (SVMFLOAT*)(file_mem+att_pos);
+    rows.index = (svm_index*)(file_mem+index_pos);
+    // the kernel tables index arrays of length dim by the attributes
+    SVMINT i;
+    SVMINT j;
+    if(((rows.start)[0] != 0) || ((rows.start)[count] != header->nnz)){
+      throw read_exception("Model file is damaged");
+    };
+    for(i=0;i<count;i++){
+      if((rows.start)[i] > (rows.start)[i+1]){
+	throw read_exception("Model file is damaged");
+      };
+      for(j=(rows.start)[i];j<(rows.start)[i+1];j++){
+	if(((rows.index)[j] < 0) || ((rows.index)[j] >= dim) ||
+	   ((j > (rows.start)[i]) && ((rows.index)[j] <= (rows.index)[j-1]))){
+	  throw read_exception("Model file is damaged");
+	};
+      };
+    };
+    kernel = the_kernel;
+    kernel->init_rows(dim,rows);
+  };
+  return the_kernel;
+};
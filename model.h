@@ -0,0 +1,87 @@
+#ifndef model_h
+#define model_h 1
+
+#include <stdlib.h>
+#include <string.h>
+#include "globals.h"
+#include "example_set.h"
+#include "kernel.h"
+
+/**
+ * The trained SVM as needed for prediction: only the SVs, their alphas
+ * and attributes contiguous in kernel_rows, b and the scaling of the
+ * training set. Built by svm_c after training or set_svs(), or, for
+ * prediction only, by read_svs() or load() without a kernel cache or
+ * any optimizer state.
+ *
+ * save() writes the model in a binary format: a model_header, the
+ * kernel definition as text, Exp and Var (if scaled), the alphas, the
+ * row starts, the attribute values and the attribute indices of the SVs,
+ * each starting at a multiple of model_align bytes. load() maps the file (#ifdef use_mmap, else it
+ * reads it into one block) and uses the arrays in place, only the
+ * kernel tables of the rows are computed.
+ *
+ * @author Stefan Rueping <rueping@ls8.cs.uni-dortmund.de>
+ * @version 0.1
+ **/
+
+
+// first bytes of a binary model file
+#define model_magic "mySVMmdl"
+// increase when the format changes
+const SVMINT model_version = 4;
+// arrays in the model file start at a multiple of this
+const SVMINT model_align = 8;
+
+typedef struct model_header{
+  char magic[8];
+  SVMINT version;
+  SVMINT size_int;    // sizeof(SVMINT), sizeof(SVMFLOAT) and
+  SVMINT size_float;  // sizeof(svm_index) of the writer
+  SVMINT size_index;
+  SVMINT count;       // number of SVs
+  SVMINT dim;
+  SVMINT nnz;         // number of attributes of all SVs
+  SVMINT kernel_length; // bytes of the kernel definition
+  SVMINT scaled;      // Exp and Var given?
+  SVMINT is_pattern;  // classification, -1 if not known
+  SVMINT sparse;      // example format of the training set, -1 if not known
+  SVMINT delimiter;
+  SVMFLOAT b;
+} MODEL_HEADER;
+
+
+class sv_model_c {
+ protected:
+  char* file_mem;  // model file if loaded, the arrays point into it
+  SVMINT file_size;
+  int file_mapped; // file_mem is mapped, not allocated
+  void take_svs(example_set_c* examples, kernel_c* new_kernel, const int kernel_has_examples);
+ public:
+  SVMINT count; // number of SVs
+  SVMFLOAT* alphas;
+  kernel_rows rows;
+  SVMFLOAT b;
+  SVMINT dim;
+  SVMFLOAT* Exp; // as in example_set_c, 0 if not scaled
+  SVMFLOAT* Var;
+  int is_pattern; // set by the svm before save(), -1 if not known
+  int sparse; // format of the training set, as is_pattern
+  char delimiter;
+  kernel_c* kernel; // that made rows
+  sv_model_c();
+  ~sv_model_c();
+  void init(example_set_c* examples, kernel_c* new_kernel); // kernel was initialised with examples
+  void read_svs(example_set_c* examples, kernel_c* new_kernel); // same for a kernel without init()
+  void clear();
+  SVMFLOAT unscale_y(const SVMFLOAT scaled_y);
+  int save(const char* filename); // 0 if the file could not be written
+  /**
+   * read a model written by save(), the kernel is read from the file
+   * and belongs to the caller.
+   **/
+  kernel_c* load(const char* filename);
+  static int is_model_file(const char* filename);
+};
+
+#endif
@@ -45,12 +45,22 @@ void parameters_c::clear(){
   convergence_epsilon=1e-3;
   shrink_const = 50;
   kernel_cache=256;
+  kernel_cache_float=0;
+  prefetch_threads=2;
+  kernel_threads=1;
+  predict_threads=2;
+  gemm_prediction=0;
+  serve_batch=64;
+  serve_queue=1024;
+  serve_report=0;
 
   use_min_prediction = 0;
 
   // verbosity
   verbosity=3;
   print_w = 0;
+  save_w = 0;
+  binary_model = 0;
   loo_estim = 0;
 
   // example formats
@@ -59,6 +69,8 @@ void parameters_c::clear(){
   default_example_format.where_y = 1;
   default_example_format.where_alpha = 0;
   default_example_format.delimiter = ' ';
+  default_example_format.binary = 0;
+  format_given = 0;
 };
 
 
@@ -272,6 +284,36 @@ istream& operator >> (istream& data_stream, parameters_c& the_parameters){
 	  throw read_exception("Invalid value for parameter 'kernel_cache'");
 	};
       }
+      else if(0 == strcmp("kernel_cache_precision",s)){
+	data_stream >> s;
+	if(0 == strcmp("float",s)){
+	  the_parameters.kernel_cache_float = 1;
+	}
+	else if(0 == strcmp("double",s)){
+	  the_parameters.kernel_cache_float = 0;
+	}
+	else{
+	  throw read_exception("Invalid value for parameter 'kernel_cache_precision'");
+	};
+      }
+      else if(0 == strcmp("prefetch_threads",s)){
+	data_stream >> the_parameters.prefetch_threads;
+	if(the_parameters.prefetch_threads < 0){
+	  throw read_exception("Invalid value for parameter 'prefetch_threads'");
+	};
+      }
+      else if(0 == strcmp("kernel_threads",s)){
+	data_stream >> the_parameters.kernel_threads;
+	if(the_parameters.kernel_threads < 1){
+	  throw read_exception("Invalid value for parameter 'kernel_threads'");
+	};
+      }
+      else if(0 == strcmp("predict_threads",s)){
+	data_stream >> the_parameters.predict_threads;
+	if(the_parameters.predict_threads < 1){
+	  throw read_exception("Invalid value for parameter 'predict_threads'");
+	};
+      }
       else if(0 == strcmp("convergence_epsilon",s)){
 	data_stream >> s;
 	the_parameters.convergence_epsilon = string2svmfloat(s);
@@ -286,9 +328,36 @@ istream& operator >> (istream& data_stream, parameters_c& the_parameters){
 	data_stream >> the_parameters.min_prediction;
 	the_parameters.use_min_prediction = 1;
       }
+      else if(0 == strcmp("serve_batch",s)){
+	data_stream >> the_parameters.serve_batch;
+	if(the_parameters.serve_batch < 1){
+	  throw read_exception("Invalid value for parameter 'serve_batch'");
+	};
+      }
+      else if(0 == strcmp("serve_queue",s)){
+	data_stream >> the_parameters.serve_queue;
+	if(the_parameters.serve_queue < 1){
+	  throw read_exception("Invalid value for parameter 'serve_queue'");
+	};
+      }
+      else if(0 == strcmp("serve_report",s)){
+	data_stream >> the_parameters.serve_report;
+	if(the_parameters.serve_report < 0){
+	  throw read_exception("Invalid value for parameter 'serve_report'");
+	};
+      }
+      else if(0 == strcmp("gemm_prediction",s)){
+	the_parameters.gemm_prediction = 1;
+      }
       else if(0 == strcmp("print_w",s)){
         the_parameters.print_w = 1;
       }
+      else if(0 == strcmp("save_w",s)){
+        the_parameters.save_w = 1;
+      }
+      else if(0 == strcmp("binary_model",s)){
+        the_parameters.binary_model = 1;
+      }
       else if(0 == strcmp("loo_estim",s)){
         the_parameters.loo_estim = 1;
       }
@@ -298,6 +367,7 @@ istream& operator >> (istream& data_stream, parameters_c& the_parameters){
       else if(0 == strcmp("format",s)){
 	// default examples format
 	data_stream >> s;
+	the_parameters.format_given = 1;
 	if(0==strcmp("sparse",s)){
 	  the_parameters.default_example_format.sparse = 1;
 	}
@@ -328,6 +398,7 @@ istream& operator >> (istream& data_stream, parameters_c& the_parameters){
       else if(0 == strcmp("delimiter",s)){
 	// default examples delimiter
 	data_stream >> s;
+	the_parameters.format_given = 1;
 	if((s[0] != '\0') && (s[1] != '\0')){
 	  the_parameters.default_example_format.delimiter = s[1];
 	}
@@ -422,7 +493,21 @@ ostream& operator << (ostream& data_stream, parameters_c& the_parameters){
   data_stream<<"descend "<<the_parameters.descend<<endl;
   data_stream<<"convergence_epsilon "<<the_parameters.convergence_epsilon<<endl;
   data_stream<<"kernel_cache "<<the_parameters.kernel_cache<<endl;
+  if(the_parameters.kernel_cache_float)
+    data_stream<<"kernel_cache_precision float"<<endl;
+  data_stream<<"prefetch_threads "<<the_parameters.prefetch_threads<<endl;
+  data_stream<<"kernel_threads "<<the_parameters.kernel_threads<<endl;
+  data_stream<<"predict_threads "<<the_parameters.predict_threads<<endl;
+  if(the_parameters.gemm_prediction)
+    data_stream<<"gemm_prediction"<<endl;
+  data_stream<<"serve_batch "<<the_parameters.serve_batch<<endl;
+  data_stream<<"serve_queue "<<the_parameters.serve_queue<<endl;
+  data_stream<<"serve_report "<<the_parameters.serve_report<<endl;
   data_stream<<"verbosity "<<the_parameters.verbosity<<endl;
+  if(the_parameters.save_w)
+    data_stream<<"save_w"<<endl;
+  if(the_parameters.binary_model)
+    data_stream<<"binary_model"<<endl;
 
   return data_stream;
 };
@@ -43,6 +43,7 @@ class parameters_c{
   int do_scale; // scale examples
   int do_scale_y; // scale y-values
   example_format default_example_format;
+  int format_given; // format or delimiter set, else take the examples' own
 
   // type of SVM
   int is_pattern; // set Lpos=0 for y>0 and Lneg=0 for y<0
@@ -73,6 +74,14 @@ class parameters_c{
   SVMFLOAT descend;  // make at least this much descend on WS
   SVMFLOAT convergence_epsilon;
   SVMINT kernel_cache;
+  int kernel_cache_float; // store cached kernel rows as float
+  SVMINT prefetch_threads; // threads computing kernel rows in advance
+  SVMINT kernel_threads; // threads sharing the computation of one kernel row
+  SVMINT predict_threads; // threads predicting blocks of a test set
+  int gemm_prediction; // predict dense models by matrix products, see kernel_c::set_gemm_rows()
+  SVMINT serve_batch; // mysvm-serve predicts up to this many requests at once
+  SVMINT serve_queue; // max. number of waiting requests of mysvm-serve
+  SVMINT serve_report; // print latencies every this many requests, 0: at the end
 
   int use_min_prediction;
   SVMFLOAT min_prediction; // let pred =  max(min_prediction,f(x))
@@ -88,6 +97,8 @@ class parameters_c{
    */
   int verbosity;
   int print_w; // print whole hyperplane?
+  int save_w; // save hyperplane instead of SVs (linear kernels)?
+  int binary_model; // save SVs in binary format, see sv_model_c
   int loo_estim; // print loo estim?
 
   SVMFLOAT get_Cpos(){ return(Lpos*realC); };
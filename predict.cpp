@@ -14,6 +14,8 @@ kernel_c* kernel=0;
 parameters_c* parameters=0;
 svm_c* svm;
 example_set_c* training_set=0;
+hyperplane_c* hyperplane=0; // saved instead of the training set?
+sv_model_c* model=0; // binary model instead of the training set?
 int is_linear=1; // linear kernel?
 
 struct example_set_list{
@@ -32,8 +34,10 @@ void print_help(){
   cout<<"The input has to consist of:"<<endl
       <<"- the svm parameters"<<endl
       <<"- the kernel definition"<<endl
-      <<"- the training result set"<<endl
+      <<"- the training result set (or the hyperplane saved with save_w,"<<endl
+      <<"  or the binary model saved with binary_model)"<<endl
       <<"- one or more sets to predict"<<endl;
+  cout<<"Each example set can also be a binary file written by my_svm -convert."<<endl;
 
   cout<<endl<<"See the documentation for the input format. The first example set to be entered is considered to be the training set, all others are test sets. Each input file can consist of one or more definitions. If no input file is specified, the input is read from <stdin>."<<endl<<endl;
 
@@ -81,7 +85,7 @@ void read_input(istream& input_stream, char* filename){
 	  if(0 != parameters){
 	    training_set->set_format(parameters->default_example_format);
 	  };
-	  input_stream  >> *training_set;	    
+	  read_examples(input_stream,filename,*training_set);
 	  training_set->set_filename(filename);
 	  cout<<"   read "<<training_set->size()<<" examples, format "<<training_set->my_format<<", dimension = "<<training_set->get_dim()<<"."<<endl;
 	}
@@ -92,7 +96,7 @@ void read_input(istream& input_stream, char* filename){
 	  if(0 != parameters){
 	    (test_set->the_set)->set_format(parameters->default_example_format);
 	  };
-	  input_stream >> *(test_set->the_set);
+	  read_examples(input_stream,filename,*(test_set->the_set));
 	  (test_set->the_set)->set_filename(filename);
 	  test_set->next = test_sets;
 	  test_sets = test_set;
@@ -104,11 +108,28 @@ void read_input(istream& input_stream, char* filename){
 	  kernel_container_c k_cont;
 	  input_stream >> k_cont;
 	  kernel = k_cont.get_kernel();
+	  is_linear = k_cont.is_linear;
 	}
 	else{
 	  cout <<"*** ERROR: Kernel multiply defined"<<endl;
 	  throw input_exception();
 	};
+      }
+      else if(0==strcmp("@hyperplane",s)){
+	if(0 == hyperplane){
+	  hyperplane = new hyperplane_c();
+	  input_stream >> *hyperplane;
+	  cout<<"   read hyperplane, dimension = "<<hyperplane->dim<<"."<<endl;
+	  if(0 == training_set){
+	    // no SVs needed, all following example sets are predicted
+	    training_set = new example_set_c();
+	    training_set->set_filename(filename);
+	  };
+	}
+	else{
+	  cout <<"*** ERROR: Hyperplane multiply defined"<<endl;
+	  throw input_exception();
+	};
       };
     }
     else{
@@ -119,7 +140,7 @@ void read_input(istream& input_stream, char* filename){
 	if(0 != parameters){
 	  training_set->set_format(parameters->default_example_format);
 	};
-	input_stream  >> *training_set;	    
+	read_examples(input_stream,filename,*training_set);
 	training_set->set_filename(filename);
 	cout<<"   read "<<training_set->size()<<" examples, format "<<training_set->my_format<<", dimension = "<<training_set->get_dim()<<"."<<endl;
       }
@@ -130,7 +151,7 @@ void read_input(istream& input_stream, char* filename){
 	if(0 != parameters){
 	  (test_set->the_set)->set_format(parameters->default_example_format);
 	};
-	input_stream >> *(test_set->the_set);
+	read_examples(input_stream,filename,*(test_set->the_set));
 	(test_set->the_set)->set_filename(filename);
 	test_set->next = test_sets;
 	test_sets = test_set;
@@ -147,6 +168,43 @@ void read_input(istream& input_stream, char* filename){
 };
 
 
+void read_model(char* filename){
+  // binary model written by mysvm with parameter binary_model
+  if(0 != model){
+    cout <<"*** ERROR: Model multiply defined"<<endl;
+    throw input_exception();
+  };
+  model = new sv_model_c();
+  // the model knows its kernel
+  kernel = model->load(filename);
+  is_linear = kernel->is_linear();
+  cout<<"   read "<<model->count<<" support vectors, dimension = "<<model->dim<<"."<<endl;
+  if(0 == training_set){
+    // no SVs needed, all following example sets are predicted
+    training_set = new example_set_c();
+    training_set->set_filename(filename);
+  };
+};
+
+
+void read_example_file(char* filename){
+  // a binary example set file
+  example_set_c* the_set = new example_set_c();
+  the_set->load(filename);
+  the_set->set_filename(filename);
+  if(0 == training_set){
+    training_set = the_set;
+  }
+  else{
+    example_set_list* test_set = new example_set_list;
+    test_set->the_set = the_set;
+    test_set->next = test_sets;
+    test_sets = test_set;
+  };
+  cout<<"   mapped "<<the_set->size()<<" examples, format "<<the_set->my_format<<", dimension = "<<the_set->get_dim()<<"."<<endl;
+};
+
+
 ///////////////////////////////////////////////////////////////
 
 
@@ -173,6 +231,14 @@ int main(int argc,char* argv[]){
 	    // read vom cin
 	    read_input(cin,"mysvm");
 	  }
+	  else if(sv_model_c::is_model_file(argv[i])){
+	    cout<<"Reading model "<<argv[i]<<endl;
+	    read_model(argv[i]);
+	  }
+	  else if(example_set_c::is_example_file(argv[i])){
+	    cout<<"Reading "<<argv[i]<<endl;
+	    read_example_file(argv[i]);
+	  }
 	  else{
 	    cout<<"Reading "<<argv[i]<<endl;
 	    ifstream input_file(argv[i]);
@@ -198,11 +264,16 @@ int main(int argc,char* argv[]){
 
   if(0 == parameters){
     parameters = new parameters_c();
-    if(training_set->initialised_pattern_y()){
+    if((0 != model) && (model->is_pattern >= 0)){
+      // the training set is empty, the model knows
+      parameters->is_pattern = model->is_pattern;
+    }
+    else if(training_set->initialised_pattern_y()){
       parameters->is_pattern = 1;
       parameters->do_scale_y = 0;
     };
   };
+  parameters->is_linear = is_linear;
   if(0 == kernel){
     kernel = new kernel_dot_c();
   };
@@ -229,14 +300,26 @@ int main(int argc,char* argv[]){
     svm = new svm_regression_c();
   };
 
-  // scale examples
-  if(parameters->do_scale){
-    training_set->scale(parameters->do_scale_y);
+  kernel->set_gemm_rows(parameters->gemm_prediction);
+  if((0 == hyperplane) && (0 == model)){
+    // only the SVs are kept, the kernel gets no cache and no examples
+    if(parameters->do_scale && (! training_set->initialised_scale())){
+      training_set->scale(parameters->do_scale_y);
+    };
+    model = new sv_model_c();
+    model->read_svs(training_set,kernel);
   };
-
-  kernel->init(parameters->kernel_cache,training_set);
+  // the training set is no longer needed
+  delete training_set;
+  training_set = 0;
   svm->init(kernel,parameters);
-  svm->set_svs(training_set);
+  if(0 != model){
+    svm->set_model(model);
+  };
+  if(0 != hyperplane){
+    // the hyperplane is in input space, the examples are not scaled
+    svm->set_hyperplane(hyperplane);
+  };
 
   // testing
   if(0 != test_sets){
@@ -248,10 +331,16 @@ int main(int argc,char* argv[]){
     while(test_sets != 0){
       test_no++;
       next_test = test_sets->the_set;
-      if(training_set->initialised_scale()){
-	next_test->scale(training_set->get_exp(),
-			 training_set->get_var(),
-			 training_set->get_dim());
+      if(next_test->initialised_scale()){
+	// from a binary file, it has to be scaled like the model
+	if((0 == model) || (! next_test->scaled_by(model->Exp,model->Var,model->dim))){
+	  cout<<"*** ERROR: "<<(next_test->get_filename())<<" was not scaled like the training set, skipping it"<<endl;
+	  test_sets = test_sets->next;
+	  continue;
+	};
+      }
+      else if((0 != model) && (0 != model->Exp)){
+	next_test->scale(model->Exp,model->Var,model->dim);
       };
       if(next_test->initialised_y()){
 	cout<<"Testing examples from file "<<(next_test->get_filename())<<endl;
@@ -0,0 +1,738 @@
+#include <stdlib.h>
+#include <string.h>
+#include <fstream.h>
+#include <strstream.h>
+#include "globals.h"
+#include "example_set.h"
+#include "svm_c.h"
+#include "svm_nu.h"
+#include "parameters.h"
+#include "kernel.h"
+#include "model.h"
+#include "version.h"
+
+#include <unistd.h>
+#include <errno.h>
+#include <signal.h>
+#ifdef use_sockets
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+/**
+ * mysvm-serve: load a trained SVM once and predict examples as they
+ * arrive, one example per line, on stdin or on a unix domain socket.
+ * The answer to each line is one line with the prediction, in the order
+ * of the requests of each connection.
+ *
+ * Readers put the lines into a queue of at most serve_queue requests and
+ * wait while it is full. One scoring thread takes up to serve_batch
+ * requests at once, reads them into one example set and predicts it by
+ * svm_c::predict(). The latencies from reading a line to writing its
+ * answer are reported to stderr.
+ *
+ * @author Stefan Rueping <rueping@ls8.cs.uni-dortmund.de>
+ * @version 0.1
+ **/
+
+
+// global svm-objects
+kernel_c* kernel=0;
+parameters_c* parameters=0;
+svm_c* svm;
+example_set_c* training_set=0;
+hyperplane_c* hyperplane=0; // saved instead of the training set?
+sv_model_c* model=0; // binary model instead of the training set?
+int is_linear=1; // linear kernel?
+SVMINT serve_dim=0; // dimension of the model
+example_format request_format; // as the examples, without y and alpha
+
+// bytes read from a connection at once
+const SVMINT serve_read_size = 65536;
+// percentiles are taken of the last serve_window requests
+const SVMINT serve_window = 65536;
+
+// a client, closed when it sent all requests and all are answered
+typedef struct serve_connection{
+  int in_fd;
+  int out_fd;
+  SVMINT pending; // requests not yet answered
+  int reading;
+} SERVE_CONNECTION;
+
+typedef struct serve_request{
+  char* line;
+  serve_connection* connection;
+  SVMFLOAT arrival; // in microseconds
+} SERVE_REQUEST;
+
+// bounded queue of requests
+serve_request* queue=0;
+SVMINT queue_first=0;
+SVMINT queue_count=0;
+int queue_closed=0;
+#ifdef use_threads
+pthread_mutex_t queue_mutex;
+pthread_cond_t queue_not_empty;
+pthread_cond_t queue_not_full;
+#endif
+
+// latencies of the last serve_window requests in microseconds
+SVMFLOAT* latencies=0;
+SVMINT requests_answered=0;
+SVMINT requests_failed=0;
+
+volatile int stop_serving=0;
+
+
+void print_help(){
+  cout<<endl;
+  cout<<"mysvm-serve: predict examples with a trained SVM as they arrive."<<endl<<endl;
+  cout<<"usage: mysvm-serve <FILE1> <FILE2> ..."<<endl
+      <<"       mysvm-serve -socket <PATH> <FILE1> <FILE2> ..."<<endl<<endl;
+  cout<<"The input files have to consist of:"<<endl
+      <<"- the svm parameters"<<endl
+      <<"- the kernel definition"<<endl
+      <<"- the training result set (or the hyperplane saved with save_w,"<<endl
+      <<"  or the binary model saved with binary_model)"<<endl;
+  cout<<"The training result set can also be a binary file written by my_svm -convert."<<endl;
+
+  cout<<endl<<"Then each line on <stdin> (or on each connection to the unix domain socket PATH) is an example in the format of the parameters (or, if they give none, of the training set or the binary model), without y. For each line one line with the prediction is written to <stdout> (or to the connection). Lines that are no example are answered by \"*** ERROR\". Latencies are printed to <stderr> every serve_report requests and at the end."<<endl<<endl;
+
+  cout<<endl<<"This software is free only for non-commercial use. It must not be modified and distributed without prior permission of the author. The author is not responsible for implications from the use of this software."<<endl;
+  exit(0);
+};
+
+
+void read_model(char* filename){
+  // binary model written by mysvm with parameter binary_model
+  if(0 != model){
+    cerr <<"*** ERROR: Model multiply defined"<<endl;
+    throw input_exception();
+  };
+  model = new sv_model_c();
+  // the model knows its kernel
+  kernel = model->load(filename);
+  is_linear = kernel->is_linear();
+  cerr<<"   read "<<model->count<<" support vectors, dimension = "<<model->dim<<"."<<endl;
+};
+
+
+void read_example_file(char* filename){
+  // training set as binary file written by mysvm -convert
+  if((0 != training_set) || (0 != model) || (0 != hyperplane)){
+    cerr <<"*** ERROR: Only the training set may be given, examples to predict are read from stdin or the socket"<<endl;
+    throw input_exception();
+  };
+  training_set = new example_set_c();
+  training_set->load(filename);
+  training_set->set_filename(filename);
+  cerr<<"   mapped "<<training_set->size()<<" examples, format "<<training_set->my_format<<", dimension = "<<training_set->get_dim()<<"."<<endl;
+};
+
+
+void read_input(istream& input_stream, char* filename){
+  char* s = new char[MAXCHAR];
+  char next;
+  next = input_stream.peek();
+  if(next == EOF){
+    // set stream to eof
+    next = input_stream.get();
+  };
+  while(! input_stream.eof()){
+    if('#' == next){
+      // ignore comment
+      input_stream.getline(s,MAXCHAR);
+    }
+    else if('\n' == next){
+      // ignore newline
+      next = input_stream.get();
+    }
+    else{
+      if('@' == next){
+	// new section
+	input_stream >> s;
+      }
+      else{
+	// default = "@examples"
+	strcpy(s,"@examples");
+      };
+      if(0==strcmp("@parameters",s)){
+	if(parameters == 0){
+	  parameters = new parameters_c();
+	  input_stream >> *parameters;
+	}
+	else{
+	  cerr <<"*** ERROR: Parameters multiply defined"<<endl;
+	  throw input_exception();
+	};
+      }
+      else if(0==strcmp("@examples",s)){
+	if((0 == training_set) && (0 == model) && (0 == hyperplane)){
+	  training_set = new example_set_c();
+	  if(0 != parameters){
+	    training_set->set_format(parameters->default_example_format);
+	  };
+	  read_examples(input_stream,filename,*training_set);
+	  training_set->set_filename(filename);
+	  cerr<<"   read "<<training_set->size()<<" examples, format "<<training_set->my_format<<", dimension = "<<training_set->get_dim()<<"."<<endl;
+	}
+	else{
+	  cerr <<"*** ERROR: Only the training set may be given, examples to predict are read from stdin or the socket"<<endl;
+	  throw input_exception();
+	};
+      }
+      else if(0==strcmp("@kernel",s)){
+	if(0 == kernel){
+	  kernel_container_c k_cont;
+	  input_stream >> k_cont;
+	  kernel = k_cont.get_kernel();
+	  is_linear = k_cont.is_linear;
+	}
+	else{
+	  cerr <<"*** ERROR: Kernel multiply defined"<<endl;
+	  throw input_exception();
+	};
+      }
+      else if(0==strcmp("@hyperplane",s)){
+	if(0 == hyperplane){
+	  hyperplane = new hyperplane_c();
+	  input_stream >> *hyperplane;
+	  cerr<<"   read hyperplane, dimension = "<<hyperplane->dim<<"."<<endl;
+	}
+	else{
+	  cerr <<"*** ERROR: Hyperplane multiply defined"<<endl;
+	  throw input_exception();
+	};
+      };
+    };
+    next = input_stream.peek();
+    if(next == EOF){
+      // set stream to eof
+      next = input_stream.get();
+    };
+  };
+  delete []s;
+};
+
+
+void init_svm(){
+  // as in predict
+  if(0 == parameters){
+    parameters = new parameters_c();
+    if((0 != model) && (model->is_pattern >= 0)){
+      // the model knows
+      parameters->is_pattern = model->is_pattern;
+    }
+    else if((0 != training_set) && training_set->initialised_pattern_y()){
+      parameters->is_pattern = 1;
+      parameters->do_scale_y = 0;
+    };
+  };
+  parameters->is_linear = is_linear;
+  if(0 == kernel){
+    kernel = new kernel_dot_c();
+  };
+  if((0 == training_set) && (0 == model) && (0 == hyperplane)){
+    cerr << "*** ERROR: You did not enter the training set"<<endl;
+    exit(1);
+  };
+
+  if(parameters->is_distribution){
+    svm = new svm_distribution_c();
+  }
+  else if(parameters->is_nu){
+    if(parameters->is_pattern){
+      svm = new svm_nu_pattern_c();
+    }
+    else{
+      svm = new svm_nu_regression_c();
+    };
+  }
+  else if(parameters->is_pattern){
+    svm = new svm_pattern_c();
+  }
+  else{
+    svm = new svm_regression_c();
+  };
+
+  // requests only hold x, in the format of the training set if the
+  // parameters do not give one
+  request_format = parameters->default_example_format;
+  if(! parameters->format_given){
+    if(0 != training_set){
+      request_format.sparse = training_set->my_format.sparse;
+      request_format.delimiter = training_set->my_format.delimiter;
+    }
+    else if((0 != model) && (model->sparse >= 0)){
+      request_format.sparse = model->sparse;
+      request_format.delimiter = model->delimiter;
+    };
+  };
+  request_format.where_x = 1;
+  request_format.where_y = 0;
+  request_format.where_alpha = 0;
+  request_format.binary = 0;
+  cerr<<"   requests in format "<<request_format<<"."<<endl;
+
+  kernel->set_gemm_rows(parameters->gemm_prediction);
+  if((0 == hyperplane) && (0 == model)){
+    if(parameters->do_scale && (! training_set->initialised_scale())){
+      training_set->scale(parameters->do_scale_y);
+    };
+    model = new sv_model_c();
+    model->read_svs(training_set,kernel);
+  };
+  if(0 != training_set){
+    delete training_set;
+    training_set = 0;
+  };
+  svm->init(kernel,parameters);
+  if(0 != model){
+    svm->set_model(model);
+    serve_dim = model->dim;
+  };
+  if(0 != hyperplane){
+    svm->set_hyperplane(hyperplane);
+    serve_dim = hyperplane->dim;
+  };
+};
+
+
+int compare_svmfloat(const void* a, const void* b){
+  SVMFLOAT x = *((const SVMFLOAT*)a);
+  SVMFLOAT y = *((const SVMFLOAT*)b);
+  return((x < y) ? -1 : ((x > y) ? 1 : 0));
+};
+
+
+void report_latencies(){
+  // percentiles of the last serve_window requests
+  SVMINT n = requests_answered;
+  if(n > serve_window) n = serve_window;
+  cerr<<"Requests: "<<requests_answered<<" answered, "<<requests_failed<<" failed"<<endl;
+  if(n <= 0){
+    return;
+  };
+  SVMFLOAT* sorted = new SVMFLOAT[n];
+  SVMINT i;
+  for(i=0;i<n;i++){
+    sorted[i] = latencies[i];
+  };
+  qsort(sorted,n,sizeof(SVMFLOAT),compare_svmfloat);
+  cerr<<"Latency (ms, last "<<n<<" requests): "
+      <<"p50 "<<sorted[(n-1)/2]/1000
+      <<"  p90 "<<sorted[(9*(n-1))/10]/1000
+      <<"  p99 "<<sorted[(99*(n-1))/100]/1000
+      <<"  max "<<sorted[n-1]/1000<<endl;
+  delete []sorted;
+};
+
+
+void lock_queue(){
+#ifdef use_threads
+  pthread_mutex_lock(&queue_mutex);
+#endif
+};
+
+
+void unlock_queue(){
+#ifdef use_threads
+  pthread_mutex_unlock(&queue_mutex);
+#endif
+};
+
+
+void release_connection(serve_connection* connection){
+  // call with the queue locked
+  if((! connection->reading) && (0 == connection->pending)){
+    if(connection->in_fd > 2) close(connection->in_fd);
+    if((connection->out_fd > 2) && (connection->out_fd != connection->in_fd)) close(connection->out_fd);
+    delete connection;
+  };
+};
+
+
+void write_all(int fd, const char* data, SVMINT length){
+  SVMINT written;
+  while(length > 0){
+    written = write(fd,data,length);
+    if(written < 0){
+      if(EINTR == errno) continue;
+      // client is gone
+      return;
+    };
+    data += written;
+    length -= written;
+  };
+};
+
+
+void answer_batch(serve_request* batch, const SVMINT count){
+  // predict all lines as one example set, then answer in order
+  example_set_c* the_set = new example_set_c();
+  the_set->set_format(request_format);
+  if(serve_dim > 0){
+    the_set->set_dim(serve_dim);
+  };
+  SVMINT* example_of = new SVMINT[count];
+  SVMINT k;
+  SVMINT size;
+  for(k=0;k<count;k++){
+    size = the_set->size();
+    example_of[k] = -1;
+    try{
+      istrstream line_stream(batch[k].line);
+      line_stream >> *the_set;
+    }
+    catch(...){
+    };
+    if(the_set->size() == size+1){
+      example_of[k] = size;
+    }
+    else if(the_set->size() > size+1){
+      // more than one example on the line, drop them
+      the_set->resize(size);
+    };
+  };
+  if(the_set->size() > 0){
+    if((0 != model) && (0 != model->Exp)){
+      the_set->scale(model->Exp,model->Var,model->dim);
+    };
+    svm->predict(the_set);
+  };
+
+  // one write for each run of requests from the same connection
+  SVMFLOAT time_done;
+  SVMINT from = 0;
+  while(from < count){
+    serve_connection* connection = batch[from].connection;
+    ostrstream answer;
+    answer.precision(10);
+    for(k=from;(k<count) && (batch[k].connection == connection);k++){
+      if(example_of[k] >= 0){
+	answer<<the_set->get_y(example_of[k])<<endl;
+      }
+      else{
+	answer<<"*** ERROR: could not read example in format "<<request_format<<endl;
+      };
+    };
+    write_all(connection->out_fd,answer.str(),answer.pcount());
+    answer.freeze(0);
+    time_done = get_wall_time();
+    lock_queue();
+    for(k=from;(k<count) && (batch[k].connection == connection);k++){
+      latencies[requests_answered%serve_window] = time_done-batch[k].arrival;
+      requests_answered++;
+      if(example_of[k] < 0){
+	requests_failed++;
+      };
+      if((parameters->serve_report > 0) && (0 == requests_answered%parameters->serve_report)){
+	report_latencies();
+      };
+      delete [](batch[k].line);
+      connection->pending--;
+    };
+    release_connection(connection);
+    unlock_queue();
+    from = k;
+  };
+  delete []example_of;
+  delete the_set;
+};
+
+
+void put_request(char* line, serve_connection* connection, SVMFLOAT arrival){
+#ifdef use_threads
+  // wait while the queue is full
+  pthread_mutex_lock(&queue_mutex);
+  while((queue_count >= parameters->serve_queue) && (! queue_closed)){
+    pthread_cond_wait(&queue_not_full,&queue_mutex);
+  };
+  if(queue_closed){
+    pthread_mutex_unlock(&queue_mutex);
+    delete []line;
+    return;
+  };
+  serve_request* request = queue+(queue_first+queue_count)%parameters->serve_queue;
+  request->line = line;
+  request->connection = connection;
+  request->arrival = arrival;
+  queue_count++;
+  connection->pending++;
+  pthread_cond_signal(&queue_not_empty);
+  pthread_mutex_unlock(&queue_mutex);
+#else
+  // no threads: answer at once
+  serve_request request;
+  request.line = line;
+  request.connection = connection;
+  request.arrival = arrival;
+  connection->pending++;
+  answer_batch(&request,1);
+#endif
+};
+
+
+void close_queue(){
+  lock_queue();
+  queue_closed = 1;
+#ifdef use_threads
+  pthread_cond_broadcast(&queue_not_empty);
+  pthread_cond_broadcast(&queue_not_full);
+#endif
+  unlock_queue();
+};
+
+
+#ifdef use_threads
+void* score_requests(void*){
+  // take up to serve_batch requests until the queue is closed and empty
+  serve_request* batch = new serve_request[parameters->serve_batch];
+  SVMINT count;
+  SVMINT k;
+  while(1){
+    pthread_mutex_lock(&queue_mutex);
+    while((0 == queue_count) && (! queue_closed)){
+      pthread_cond_wait(&queue_not_empty,&queue_mutex);
+    };
+    if(0 == queue_count){
+      pthread_mutex_unlock(&queue_mutex);
+      break;
+    };
+    count = queue_count;
+    if(count > parameters->serve_batch) count = parameters->serve_batch;
+    for(k=0;k<count;k++){
+      batch[k] = queue[(queue_first+k)%parameters->serve_queue];
+    };
+    queue_first = (queue_first+count)%parameters->serve_queue;
+    queue_count -= count;
+    pthread_cond_broadcast(&queue_not_full);
+    pthread_mutex_unlock(&queue_mutex);
+    answer_batch(batch,count);
+  };
+  delete []batch;
+  return 0;
+};
+#endif
+
+
+void read_requests(serve_connection* connection){
+  // split the input into lines, each is a request
+  char* buffer = new char[serve_read_size];
+  SVMINT line_capacity = 1024;
+  char* line = new char[line_capacity];
+  SVMINT line_length = 0;
+  SVMINT got;
+  SVMINT k;
+  char* new_line;
+  SVMFLOAT arrival;
+  while(! stop_serving){
+    got = read(connection->in_fd,buffer,serve_read_size);
+    if(got < 0){
+      if((EINTR == errno) && (! stop_serving)) continue;
+      break;
+    };
+    if(0 == got){
+      break;
+    };
+    arrival = get_wall_time();
+    for(k=0;k<got;k++){
+      if('\n' == buffer[k]){
+	if((line_length > 0) && ('\r' == line[line_length-1])){
+	  line_length--;
+	};
+	if(line_length > 0){
+	  new_line = new char[line_length+1];
+	  memcpy(new_line,line,line_length);
+	  new_line[line_length] = '\0';
+	  put_request(new_line,connection,arrival);
+	};
+	line_length = 0;
+      }
+      else{
+	if(line_length+1 >= line_capacity){
+	  new_line = new char[2*line_capacity];
+	  memcpy(new_line,line,line_length);
+	  delete []line;
+	  line = new_line;
+	  line_capacity *= 2;
+	};
+	line[line_length] = buffer[k];
+	line_length++;
+      };
+    };
+  };
+  if(line_length > 0){
+    // last line without newline
+    new_line = new char[line_length+1];
+    memcpy(new_line,line,line_length);
+    new_line[line_length] = '\0';
+    put_request(new_line,connection,get_wall_time());
+  };
+  delete []line;
+  delete []buffer;
+  lock_queue();
+  connection->reading = 0;
+  release_connection(connection);
+  unlock_queue();
+};
+
+
+#ifdef use_sockets
+#ifdef use_threads
+void* connection_reader(void* the_connection){
+  read_requests((serve_connection*)the_connection);
+  return 0;
+};
+#endif
+#endif
+
+
+void serve_socket(char* path){
+#if defined(use_sockets) && defined(use_threads)
+  int listen_fd = socket(AF_UNIX,SOCK_STREAM,0);
+  struct sockaddr_un address;
+  memset(&address,0,sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path,path,sizeof(address.sun_path)-1);
+  unlink(path);
+  if((listen_fd < 0) ||
+     (0 != bind(listen_fd,(struct sockaddr*)&address,sizeof(address))) ||
+     (0 != listen(listen_fd,16))){
+    cerr<<"*** ERROR: Could not listen on socket "<<path<<endl;
+    exit(1);
+  };
+  cerr<<"Listening on "<<path<<endl;
+  int fd;
+  pthread_t reader;
+  serve_connection* connection;
+  while(! stop_serving){
+    fd = accept(listen_fd,0,0);
+    if(fd < 0){
+      if(EINTR == errno) continue;
+      break;
+    };
+    connection = new serve_connection;
+    connection->in_fd = fd;
+    connection->out_fd = fd;
+    connection->pending = 0;
+    connection->reading = 1;
+    if(0 != pthread_create(&reader,0,connection_reader,connection)){
+      close(fd);
+      delete connection;
+      continue;
+    };
+    pthread_detach(reader);
+  };
+  close(listen_fd);
+  unlink(path);
+#else
+  cerr<<"*** ERROR: mysvm-serve was compiled without sockets"<<endl;
+  exit(1);
+#endif
+};
+
+
+void stop_handler(int){
+  stop_serving = 1;
+};
+
+
+///////////////////////////////////////////////////////////////
+
+
+int main(int argc,char* argv[]){
+  cerr<<"*** mySVM version "<<mysvmversion<<" ***"<<endl;
+  char* socket_path = 0;
+  // read objects
+  try{
+    if(argc<2){
+      print_help();
+    };
+    for(int i=1;i<argc;i++){
+      if((0==strcmp("-h",argv[i])) || (0==strcmp("-help",argv[i])) || (0==strcmp("--help",argv[i]))){
+	print_help();
+      }
+      else if(0==strcmp("-socket",argv[i])){
+	if(i+1 >= argc){
+	  print_help();
+	};
+	i++;
+	socket_path = argv[i];
+      }
+      else if(sv_model_c::is_model_file(argv[i])){
+	cerr<<"Reading model "<<argv[i]<<endl;
+	read_model(argv[i]);
+      }
+      else if(example_set_c::is_example_file(argv[i])){
+	cerr<<"Reading "<<argv[i]<<endl;
+	read_example_file(argv[i]);
+      }
+      else{
+	cerr<<"Reading "<<argv[i]<<endl;
+	ifstream input_file(argv[i]);
+	if(input_file.bad()){
+	  cerr<<"ERROR: Could not read file \""<<argv[i]<<"\", exiting."<<endl;
+	  exit(1);
+	};
+	read_input(input_file,argv[i]);
+	input_file.close();
+      };
+    };
+  }
+  catch(general_exception &the_ex){
+    cerr<<"*** Error while reading input: "<<the_ex.error_msg<<endl;
+    exit(1);
+  }
+  catch(...){
+    cerr<<"*** Program ended because of unknown error while reading input"<<endl;
+    exit(1);
+  };
+  init_svm();
+
+  // stop on SIGINT and SIGTERM, let blocking calls return
+  struct sigaction action;
+  memset(&action,0,sizeof(action));
+  action.sa_handler = stop_handler;
+  sigaction(SIGINT,&action,0);
+  sigaction(SIGTERM,&action,0);
+  signal(SIGPIPE,SIG_IGN);
+
+  latencies = new SVMFLOAT[serve_window];
+#ifdef use_threads
+  queue = new serve_request[parameters->serve_queue];
+  pthread_mutex_init(&queue_mutex,0);
+  pthread_cond_init(&queue_not_empty,0);
+  pthread_cond_init(&queue_not_full,0);
+  pthread_t scorer;
+  if(0 != pthread_create(&scorer,0,score_requests,0)){
+    cerr<<"*** ERROR: Could not start the scoring thread"<<endl;
+    exit(1);
+  };
+#endif
+
+  if(0 != socket_path){
+    serve_socket(socket_path);
+  }
+  else{
+    serve_connection* connection = new serve_connection;
+    connection->in_fd = 0;
+    connection->out_fd = 1;
+    connection->pending = 0;
+    connection->reading = 1;
+    read_requests(connection);
+  };
+
+  // answer what is queued
+  close_queue();
+#ifdef use_threads
+  pthread_join(scorer,0);
+#endif
+  report_latencies();
+  if(parameters->verbosity > 1){
+    cerr << "mysvm-serve ended successfully."<<endl;
+  };
+  return(0);
+};
@@ -1,5 +1,132 @@
 #include "svm_c.h"
 
+
+/**
+ *
+ * hyperplane_c
+ *
+ **/
+
+hyperplane_c::hyperplane_c(){
+  dim = 0;
+  w = 0;
+  b = 0;
+};
+
+
+hyperplane_c::hyperplane_c(SVMINT new_dim){
+  w = 0;
+  b = 0;
+  init(new_dim);
+};
+
+
+hyperplane_c::~hyperplane_c(){
+  if(0 != w) delete []w;
+};
+
+
+void hyperplane_c::init(SVMINT new_dim){
+  if(0 != w) delete []w;
+  dim = new_dim;
+  w = new SVMFLOAT[dim];
+  SVMINT j;
+  for(j=0;j<dim;j++){
+    w[j] = 0;
+  };
+};
+
+
+ostream& operator<< (ostream& data_stream, hyperplane_c& the_hyperplane){
+  data_stream << "# svm hyperplane" << endl;
+  data_stream << "dimension " << the_hyperplane.dim << endl;
+  data_stream << "b " << the_hyperplane.b << endl;
+  // sparse, index runs from 1 to dim as in the examples
+  data_stream << "w";
+  SVMINT j;
+  for(j=0;j<the_hyperplane.dim;j++){
+    if(0 != the_hyperplane.w[j]){
+      data_stream << " " << (j+1) << ":" << the_hyperplane.w[j];
+    };
+  };
+  data_stream << endl;
+  return data_stream;
+};
+
+
+istream& operator>> (istream& data_stream, hyperplane_c& the_hyperplane){
+  char* s = new char[MAXCHAR];
+  char next=0;
+  SVMINT pos;
+  SVMINT spos;
+  while((next != EOF) && ('@' != next) && (! data_stream.eof())){
+    next = data_stream.peek();
+    if(next == EOF){ 
+      // set stream to eof
+      next = data_stream.get(); 
+    };
+    if(('@' == next) || (data_stream.eof())){
+      // end of this section
+    }
+    else if(('\n' == next) ||
+	    (' ' == next) ||
+	    ('\r' == next) ||
+	    ('\t' == next)){
+      // ignore
+      next = data_stream.get();
+    }
+    else if('#' == next){
+      // line contains commentary
+      data_stream.getline(s,MAXCHAR);
+    }
+    else{
+      data_stream >> s;
+      if((0 == strcmp("dimension",s)) || (0==strcmp("dim",s))){
+	data_stream >> pos;
+	if(pos < 0){
+	  throw read_exception("Invalid dimension of hyperplane");
+	};
+	the_hyperplane.init(pos);
+      }
+      else if(0 == strcmp("b",s)){
+	data_stream >> s;
+	the_hyperplane.b = string2svmfloat(s);
+      }
+      else if(0 == strcmp("w",s)){
+	// index:value up to the end of the line
+	while((! data_stream.eof()) && ('\n' != data_stream.peek())){
+	  if((' ' == data_stream.peek()) || 
+	     ('\t' == data_stream.peek()) ||
+	     ('\r' == data_stream.peek())){
+	    data_stream.get();
+	  }
+	  else{
+	    data_stream >> s;
+	    spos = 0;
+	    while((s[spos] != '\0') && (s[spos] != ':')){
+	      spos++;
+	    };
+	    pos = atoi(s);
+	    if((s[spos] == '\0') || (pos <= 0) || (pos > the_hyperplane.dim)){
+	      throw read_exception("Invalid entry of w, dimension must be given first");
+	    };
+	    the_hyperplane.w[pos-1] = string2svmfloat(s+spos+1);
+	  };
+	};
+      }
+      else{
+	char* t = new char[MAXCHAR];
+	strcpy(t,"Unknown parameter: ");
+	strcat(t,s);
+	throw read_exception(t);
+      };
+    };
+  };
+  delete []s;
+  return data_stream;
+};
+
+
 /**
  *
  * svm_c
@@ -9,6 +136,12 @@
 svm_c::svm_c(){
   // initialise arrays
   sum =0;
+  folding = 0;
+  fold_w = 0;
+  w_linear = 0;
+  w_dim = 0;
+  w_b = 0;
+  model = 0;
   primal=0;
   which_alpha = 0;
   lambda_eq=0;
@@ -18,6 +151,7 @@ svm_c::svm_c(){
   all_ys=0;
   working_set=0;
   working_set_values=0;
+  ws_row=0;
   time_init=0;
   time_optimize=0;
   time_convergence=0;
@@ -29,6 +163,11 @@ svm_c::svm_c(){
 
 void svm_c::init(kernel_c* new_kernel, parameters_c* new_parameters){
   sum =0;
+  folding = 0;
+  fold_w = 0;
+  w_linear = 0;
+  w_dim = 0;
+  w_b = 0;
   primal=0;
   which_alpha = 0;
   lambda_eq=0;
@@ -82,6 +221,7 @@ void svm_c::init_optimizer(){
   // reserve workspace for calculate_working_set
   working_set = new SVMINT[working_set_size];
   working_set_values = new SVMFLOAT[working_set_size];
+  ws_row = new SVMFLOAT[working_set_size];
 
   if(parameters->do_scale_y){
     epsilon_pos /= examples->get_y_var();
@@ -108,6 +248,61 @@ void svm_c::init_optimizer(){
   to_shrink=0;
 
   smo.init(parameters->is_zero,parameters->convergence_epsilon,working_set_size*working_set_size);
+
+  // folding costs O(nnz) per iteration, cached rows are cheaper if
+  // they all fit in the cache
+  folding = (parameters->is_linear && kernel->is_linear() &&
+	     (! kernel->fits_in_cache(examples_total)));
+  if(folding){
+    fold_b = kernel->K_of_dot(0);
+    fold_a = kernel->K_of_dot(1)-fold_b;
+    SVMINT dim = kernel->w_size();
+    if(0 != fold_w) delete []fold_w;
+    fold_w = new SVMFLOAT[dim];
+    for(i=0;i<dim;i++){
+      fold_w[i] = 0;
+    };
+    fold_w_sum = 0;
+    if(parameters->verbosity>=3){
+      cout<<"Linear kernel, using folding"<<endl;
+    };
+  };
+};
+
+
+void svm_c::init_folding(){
+  SVMINT dim = kernel->w_size();
+  SVMINT i;
+  for(i=0;i<dim;i++){
+    fold_w[i] = 0;
+  };
+  fold_w_sum = 0;
+  for(i=0;i<examples->size();i++){
+    if(0 != all_alphas[i]){
+      fold_alpha(i,all_alphas[i]);
+    };
+  };
+};
+
+
+void svm_c::fold_alpha(const SVMINT i, const SVMFLOAT alpha_diff){
+  // alpha of position i changed by alpha_diff, O(nnz)
+  svm_example x = examples->get_example((kernel->get_active())[i]);
+  SVMINT k;
+  for(k=0;k<x.length;k++){
+    fold_w[(x.index)[k]] += alpha_diff*(x.att)[k];
+  };
+  fold_w_sum += alpha_diff;
+};
+
+
+void svm_c::update_folded_sums(const SVMINT from, const SVMINT to){
+  // sum of positions from..to-1 from fold_w
+  kernel->dot_positions(fold_w,from,to,sum+from);
+  SVMINT i;
+  for(i=from;i<to;i++){
+    sum[i] = fold_a*sum[i]+fold_b*fold_w_sum;
+  };
 };
 
 
@@ -122,13 +317,17 @@ void svm_c::exit_optimizer(){
   delete []primal;
   delete []working_set;
   delete []working_set_values;
+  delete []ws_row;
   delete []sum;
   delete []at_bound;
   delete []which_alpha;
+  if(0 != fold_w) delete []fold_w;
+  fold_w = 0;
 
   primal = 0;
   working_set = 0;
   working_set_values = 0;
+  ws_row = 0;
   sum=0;
   at_bound=0;
   which_alpha=0;
@@ -274,6 +473,112 @@ void svm_c::set_svs(example_set_c* training_examples){
   test_set = training_examples;
   examples_total = training_examples->size();
   all_alphas = examples->get_alphas();
+  if(0 == model) model = new sv_model_c();
+  model->init(examples,kernel);
+  collapse_w();
+  kernel->pack_rows(model->rows);
+};
+
+
+void svm_c::collapse_w(){
+  // sum_i alpha_i K(x_i,x)+b = w*x+b for K(x,y) = a*x*y+c
+  if(0 != w_linear){
+    delete []w_linear;
+    w_linear = 0;
+  };
+  if(! (parameters->is_linear && kernel->is_linear())){
+    return;
+  };
+  SVMFLOAT c = kernel->K_of_dot(0);
+  SVMFLOAT a = kernel->K_of_dot(1)-c;
+  SVMINT i,j;
+  SVMFLOAT alpha;
+  SVMFLOAT* att = (model->rows).att;
+  svm_index* index = (model->rows).index;
+  w_dim = model->dim;
+  w_linear = new SVMFLOAT[w_dim];
+  w_b = model->b;
+  for(j=0;j<w_dim;j++){
+    w_linear[j] = 0;
+  };
+  for(i=0;i<model->count;i++){
+    alpha = (model->alphas)[i];
+    for(j=((model->rows).start)[i];j<((model->rows).start)[i+1];j++){
+      w_linear[index[j]] += a*alpha*att[j];
+    };
+    w_b += c*alpha;
+  };
+};
+
+
+hyperplane_c* svm_c::get_hyperplane(){
+  if(0 == w_linear){
+    return 0;
+  };
+  hyperplane_c* the_hyperplane = new hyperplane_c(w_dim);
+  SVMFLOAT* w = the_hyperplane->w;
+  SVMFLOAT b = w_b;
+  SVMINT j;
+  for(j=0;j<w_dim;j++){
+    w[j] = w_linear[j];
+  };
+  if((0 != model->Exp) && (0 != model->Var)){
+    // undo x -> (x-exp)/var and y -> (y-exp)/var
+    SVMFLOAT* exp = model->Exp;
+    SVMFLOAT* var = model->Var;
+    for(j=0;j<w_dim;j++){
+      if(var[j] != 0){
+	w[j] /= var[j];
+      };
+      b -= w[j]*exp[j];
+    };
+    if(var[w_dim] != 0){
+      for(j=0;j<w_dim;j++){
+	w[j] *= var[w_dim];
+      };
+      b *= var[w_dim];
+    };
+    b += exp[w_dim];
+  };
+  the_hyperplane->b = b;
+  return the_hyperplane;
+};
+
+
+void svm_c::set_hyperplane(hyperplane_c* the_hyperplane){
+  // the hyperplane is in input space, examples should not be scaled
+  if(0 != w_linear){
+    delete []w_linear;
+  };
+  w_dim = the_hyperplane->dim;
+  w_linear = new SVMFLOAT[w_dim];
+  SVMINT j;
+  for(j=0;j<w_dim;j++){
+    w_linear[j] = the_hyperplane->w[j];
+  };
+  w_b = the_hyperplane->b;
+  if(0 == model){
+    // nothing to unscale
+    model = new sv_model_c();
+  };
+};
+
+
+void svm_c::set_model(sv_model_c* the_model){
+  if(0 != model) delete model;
+  model = the_model;
+  collapse_w();
+  kernel->pack_rows(model->rows);
+};
+
+
+int svm_c::save_model(const char* filename){
+  model->is_pattern = is_pattern;
+  if(0 != examples){
+    model->sparse = examples->my_format.sparse;
+    model->delimiter = examples->my_format.delimiter;
+  };
+  return(model->save(filename));
 };
 
 
@@ -290,6 +595,12 @@ void svm_c::reset_shrinked(){
     sum[i] = 0;
     at_bound[i] = 0;
   };
+  if(folding){
+    // fold_w still holds the shrinked alphas
+    update_folded_sums(old_ex_tot,examples_total);
+    sum_alpha=0;
+    return;
+  };
   for(i=0;i<examples_total;i++){
     if(abs(all_alphas[i])>is_zero){
       for(j=old_ex_tot;j<examples_total;j++){
@@ -305,7 +616,7 @@ void svm_c::reset_shrinked(){
 SVMFLOAT svm_c::avg_norm2(){
   SVMFLOAT avg=0.0;
   for(SVMINT i=0;i<examples_total;i++){
-      avg += kernel->calculate_K(i,i);
+      avg += kernel->get_diag(i);
   };
   avg /= (SVMFLOAT)examples_total;
   return(avg);
@@ -323,8 +634,15 @@ svm_result svm_c::train(example_set_c* training_examples){
   time_all = time_init;
 
   examples_total = training_examples->size();
-  all_alphas = examples->get_alphas();
-  all_ys = examples->get_ys();
+  // the solver works on its own copies, the examples never move
+  all_alphas = new SVMFLOAT[examples_total];
+  if(0 != all_ys) delete []all_ys; // of the last training
+  all_ys = new SVMFLOAT[examples_total];
+  SVMINT i;
+  for(i=0;i<examples_total;i++){
+    all_alphas[i] = (examples->get_alphas())[i];
+    all_ys[i] = (examples->get_ys())[i];
+  };
   SVMINT param_wss = parameters->working_set_size;
   if(param_wss > examples_total){
     parameters->working_set_size = examples_total;
@@ -414,8 +732,6 @@ svm_result svm_c::train(example_set_c* training_examples){
     optimize(); 
     put_optimizer_values();
 
-    SVMINT i;
-
 //     SVMFLOAT now_target=0;
 //     SVMFLOAT now_target_dummy=0;
 //     for(i=0;i<examples_total;i++){
@@ -508,6 +824,9 @@ svm_result svm_c::train(example_set_c* training_examples){
     shrink();
 
     calculate_working_set();
+    if(! folding){
+      kernel->prefetch(working_set,working_set_size);
+    };
     update_working_set();
 
     if(parameters->verbosity >= 4){
@@ -533,7 +852,6 @@ svm_result svm_c::train(example_set_c* training_examples){
     };
   };
 
-  SVMINT i;
   if(iteration >= max_iterations){
     cout<<"*** No convergence: Time up."<<endl;
     if(examples_total<examples->size()){
@@ -553,6 +871,8 @@ svm_result svm_c::train(example_set_c* training_examples){
 
   time_all = get_time() - time_all;
 
+  restore_example_order();
+
   // calculate b
   SVMFLOAT new_b=0;
   SVMINT new_b_count=0;
@@ -565,7 +885,6 @@ svm_result svm_c::train(example_set_c* training_examples){
       new_b +=  all_ys[i] - sum[i]+epsilon_pos;
       new_b_count++;
     };
-    examples->put_alpha(i,all_alphas[i]);
   };
 
   if(new_b_count>0){
@@ -613,6 +932,10 @@ svm_result svm_c::train(example_set_c* training_examples){
     };
   };
 
+  if(0 == model) model = new sv_model_c();
+  model->init(examples,kernel);
+  collapse_w();
+  kernel->pack_rows(model->rows);
   the_result = print_statistics();
 
   exit_optimizer();
@@ -633,10 +956,7 @@ void svm_c::shrink(){
 		// shrinxk i
 		sum_alpha += all_alphas[i];
 		last_pos--;
-		examples->swap(i,last_pos);
-		kernel->overwrite(i,last_pos);
-		sum[i] = sum[last_pos];
-		at_bound[i] = at_bound[last_pos];
+		shrink_variable(i,last_pos);
 		if(last_pos <= working_set_size){
 		    break;
 		};
@@ -653,6 +973,48 @@ void svm_c::shrink(){
 };
 
 
+void svm_c::shrink_variable(const SVMINT i, const SVMINT last_pos){
+  // variable i leaves the active positions, last_pos takes its place.
+  // sum and at_bound of shrinked variables are recalculated later.
+  SVMINT* active = kernel->get_active();
+  SVMINT ex = active[i];
+  active[i] = active[last_pos];
+  active[last_pos] = ex;
+  SVMFLOAT dummy = all_alphas[i];
+  all_alphas[i] = all_alphas[last_pos];
+  all_alphas[last_pos] = dummy;
+  dummy = all_ys[i];
+  all_ys[i] = all_ys[last_pos];
+  all_ys[last_pos] = dummy;
+  sum[i] = sum[last_pos];
+  at_bound[i] = at_bound[last_pos];
+};
+
+
+void svm_c::restore_example_order(){
+  // write back alphas, and bring ys and sum in the order of the examples.
+  // the ys stay ours, the solver may have changed them
+  SVMINT* active = kernel->get_active();
+  SVMFLOAT* ex_ys = new SVMFLOAT[examples_total];
+  SVMFLOAT* new_sum = new SVMFLOAT[examples_total];
+  SVMINT i;
+  for(i=0;i<examples_total;i++){
+    examples->put_alpha(active[i],all_alphas[i]);
+    ex_ys[active[i]] = all_ys[i];
+    new_sum[active[i]] = sum[i];
+  };
+  for(i=0;i<examples_total;i++){
+    sum[i] = new_sum[i];
+  };
+  delete []new_sum;
+  delete []all_alphas;
+  delete []all_ys;
+  all_alphas = examples->get_alphas();
+  all_ys = ex_ys;
+  kernel->reset_active();
+};
+
+
 int svm_c::convergence(){
   long time_start = get_time();
   SVMFLOAT the_lambda_eq = 0;
@@ -1153,9 +1515,14 @@ void svm_c::init_working_set(){
     if(parameters->verbosity >= 2){
       cout<<"Initialising variables, this may take some time."<<endl;
     };
+    if(folding){
+      init_folding();
+      update_folded_sums(0,examples_total);
+    };
     for(i=0; i<examples_total;i++){
-      sum[i] = 0;
       at_bound[i] = 0;
+      if(folding) continue;
+      sum[i] = 0;
       for(j=0; j<examples_total;j++){
 	sum[i] += all_alphas[j]*kernel->calculate_K(i,j);
       };
@@ -1202,7 +1569,9 @@ void svm_c::put_optimizer_values(){
   SVMINT pos_i;
   SVMFLOAT the_new_alpha;
   SVMFLOAT* kernel_row;
+  float* kernel_row_f;
   SVMFLOAT alpha_diff;
+  int changed=0;
 
   long time_start = get_time();
   pos_i=working_set_size;
@@ -1219,14 +1588,30 @@ void svm_c::put_optimizer_values(){
     alpha_diff = the_new_alpha-all_alphas[i];
     all_alphas[i] = the_new_alpha;
 
-    if(alpha_diff != 0){
+    if((alpha_diff != 0) && folding){
+      fold_alpha(i,alpha_diff);
+      changed = 1;
+    }
+    else if(alpha_diff != 0){
       // update sum ( => nabla)
-      kernel_row = kernel->get_row(i);
-      for(j=0;j<examples_total;j++){
-	sum[j] += alpha_diff*kernel_row[j];
+      if(kernel->is_cache_float()){
+	kernel_row_f = kernel->get_row_float(i);
+	for(j=0;j<examples_total;j++){
+	  sum[j] += alpha_diff*kernel_row_f[j];
+	};
+      }
+      else{
+	kernel_row = kernel->get_row(i);
+	for(j=0;j<examples_total;j++){
+	  sum[j] += alpha_diff*kernel_row[j];
+	};
       };
     };
   };
+  if(changed){
+    // sum (=> nabla) from w, O(nnz) of the active examples
+    update_folded_sums(0,examples_total);
+  };
   time_update += get_time() - time_start;
 };
 
@@ -1237,13 +1622,31 @@ void svm_c::update_working_set(){
   SVMINT i,j;
   SVMINT pos_i, pos_j;
   SVMFLOAT* kernel_row;
+  float* kernel_row_f;
   SVMFLOAT sum_WS;
 
   for(pos_i=0;pos_i<working_set_size;pos_i++){
     i = working_set[pos_i];
 
     // put row sort_i in hessian 
-    kernel_row = kernel->get_row(i);
+    if(folding){
+      // no rows needed, only K(i,j) for j in WS
+      for(pos_j=0;pos_j<working_set_size;pos_j++){
+	ws_row[pos_j] = kernel->calculate_K(i,working_set[pos_j]);
+      };
+    }
+    else if(kernel->is_cache_float()){
+      kernel_row_f = kernel->get_row_float(i);
+      for(pos_j=0;pos_j<working_set_size;pos_j++){
+	ws_row[pos_j] = kernel_row_f[working_set[pos_j]];
+      };
+    }
+    else{
+      kernel_row = kernel->get_row(i);
+      for(pos_j=0;pos_j<working_set_size;pos_j++){
+	ws_row[pos_j] = kernel_row[working_set[pos_j]];
+      };
+    };
     sum_WS=0;
     //    for(pos_j=0;pos_j<working_set_size;pos_j++){
     for(pos_j=0;pos_j<pos_i;pos_j++){
@@ -1252,21 +1655,21 @@ void svm_c::update_working_set(){
       if(((which_alpha[pos_j] < 0) && (which_alpha[pos_i] < 0)) ||
 	 ((which_alpha[pos_j] > 0) && (which_alpha[pos_i] > 0))){
 	// both i and j positive or negative
-	(qp.H)[pos_i*working_set_size+pos_j] = kernel_row[j];
-	(qp.H)[pos_j*working_set_size+pos_i] = kernel_row[j];
+	(qp.H)[pos_i*working_set_size+pos_j] = ws_row[pos_j];
+	(qp.H)[pos_j*working_set_size+pos_i] = ws_row[pos_j];
       }
       else{
 	// one of i and j positive, one negative
-	(qp.H)[pos_i*working_set_size+pos_j] = -kernel_row[j];
-	(qp.H)[pos_j*working_set_size+pos_i] = -kernel_row[j];
+	(qp.H)[pos_i*working_set_size+pos_j] = -ws_row[pos_j];
+	(qp.H)[pos_j*working_set_size+pos_i] = -ws_row[pos_j];
       };
     };
     for(pos_j=0;pos_j<working_set_size;pos_j++){
       j = working_set[pos_j];
-      sum_WS+=all_alphas[j]*kernel_row[j];
+      sum_WS+=all_alphas[j]*ws_row[pos_j];
     };
     // set main diagonal 
-    (qp.H)[pos_i*working_set_size+pos_i] = kernel_row[i];
+    (qp.H)[pos_i*working_set_size+pos_i] = kernel->get_diag(i);
 
     // linear and box constraints
     if(which_alpha[pos_i]<0){
@@ -1314,7 +1717,6 @@ svm_result svm_c::test(example_set_c* test_examples, int verbose){
   SVMINT i;
   SVMFLOAT MAE=0;
   SVMFLOAT MSE=0;
-  SVMFLOAT actloss=0;
   SVMFLOAT theloss=0;
   SVMFLOAT theloss_pos=0;
   SVMFLOAT theloss_neg=0;
@@ -1326,41 +1728,28 @@ svm_result svm_c::test(example_set_c* test_examples, int verbose){
   SVMINT total_pos=0;
   SVMINT total_neg=0;
 
-  SVMFLOAT prediction;
-  SVMFLOAT y;
-  svm_example example;
-  for(i=0;i<test_set->size();i++){
-    example = test_set->get_example(i);
-    prediction = predict(example);
-    y = examples->unscale_y(test_set->get_y(i));
-    MAE += abs(y-prediction);
-    MSE += (y-prediction)*(y-prediction);
-    actloss=loss(prediction,y);
-    theloss+=actloss;
-    if(y < prediction-parameters->epsilon_pos){
-      theloss_pos += actloss;
-      countpos++;
-    }
-    else if(y > prediction+parameters->epsilon_neg){
-      theloss_neg += actloss;
-      countneg++;
-    };
-    // if pattern!
-    if(is_pattern){
-      if(y>0){
-	if(prediction>0){
-	  correct_pos++;
-	};
-	total_pos++;
-      }
-      else{
-	if(prediction<=0){
-	  correct_neg++;
-	};
-	total_neg++;
-      };
-    };    
-  };
+  // sums of the blocks, added in order so the result does not depend
+  // on the number of threads
+  SVMINT n = test_set->size();
+  SVMINT blocks = (n+predict_block-1)/predict_block;
+  SVMFLOAT* predictions = new SVMFLOAT[n+1];
+  test_sums* sums = new test_sums[blocks+1];
+  predict_set(test_set,predictions,sums);
+  for(i=0;i<blocks;i++){
+    MAE += sums[i].MAE;
+    MSE += sums[i].MSE;
+    theloss += sums[i].loss;
+    theloss_pos += sums[i].loss_pos;
+    theloss_neg += sums[i].loss_neg;
+    countpos += sums[i].countpos;
+    countneg += sums[i].countneg;
+    correct_pos += sums[i].correct_pos;
+    correct_neg += sums[i].correct_neg;
+    total_pos += sums[i].total_pos;
+    total_neg += sums[i].total_neg;
+  };
+  delete []sums;
+  delete []predictions;
   if(countpos != 0){
     theloss_pos /= (SVMFLOAT)countpos;
   };
@@ -1702,19 +2091,149 @@ void svm_c::optimize(){
 };
 
 
-void svm_c::predict(example_set_c* test_examples){
-  test_set = test_examples;
+void svm_c::test_examples(example_set_c* the_set, const SVMINT from, const SVMINT to, const SVMFLOAT* predictions, test_sums& sums){
+  // sums of test() for examples from..to-1
   SVMINT i;
   SVMFLOAT prediction;
-  svm_example example;
+  SVMFLOAT y;
+  SVMFLOAT actloss;
+  sums.MAE = 0;
+  sums.MSE = 0;
+  sums.loss = 0;
+  sums.loss_pos = 0;
+  sums.loss_neg = 0;
+  sums.countpos = 0;
+  sums.countneg = 0;
+  sums.correct_pos = 0;
+  sums.correct_neg = 0;
+  sums.total_pos = 0;
+  sums.total_neg = 0;
+  for(i=from;i<to;i++){
+    prediction = predictions[i];
+    y = model->unscale_y(the_set->get_y(i));
+    sums.MAE += abs(y-prediction);
+    sums.MSE += (y-prediction)*(y-prediction);
+    actloss=loss(prediction,y);
+    sums.loss+=actloss;
+    if(y < prediction-parameters->epsilon_pos){
+      sums.loss_pos += actloss;
+      sums.countpos++;
+    }
+    else if(y > prediction+parameters->epsilon_neg){
+      sums.loss_neg += actloss;
+      sums.countneg++;
+    };
+    // if pattern!
+    if(is_pattern){
+      if(y>0){
+	if(prediction>0){
+	  sums.correct_pos++;
+	};
+	sums.total_pos++;
+      }
+      else{
+	if(prediction<=0){
+	  sums.correct_neg++;
+	};
+	sums.total_neg++;
+      };
+    };    
+  };
+};
+
+
+void svm_c::run_predict_job(predict_job* job){
+  // take blocks until none is left
+  SVMINT block;
+  SVMINT from;
+  SVMINT to;
+  SVMINT k;
+  svm_example x[predict_block];
+  while(1){
+#ifdef use_threads
+    pthread_mutex_lock(&(job->mutex));
+#endif
+    block = job->next_block;
+    job->next_block++;
+#ifdef use_threads
+    pthread_mutex_unlock(&(job->mutex));
+#endif
+    if(block >= job->blocks){
+      break;
+    };
+    from = block*predict_block;
+    to = from+predict_block;
+    if(to > (job->set)->size()) to = (job->set)->size();
+    for(k=from;k<to;k++){
+      x[k-from] = (job->set)->get_example(k);
+    };
+    predict_examples(x,to-from,(job->predictions)+from);
+    if(0 != job->sums){
+      test_examples(job->set,from,to,job->predictions,(job->sums)[block]);
+    };
+  };
+};
 
+
+#ifdef use_threads
+void* svm_c::predict_worker(void* the_job){
+  predict_job* job = (predict_job*)the_job;
+  (job->svm)->run_predict_job(job);
+  return 0;
+};
+#endif
+
+
+void svm_c::predict_set(example_set_c* the_set, SVMFLOAT* predictions, test_sums* sums){
+  // blocks of the_set are taken by predict_threads threads
+  predict_job job;
+  job.svm = this;
+  job.set = the_set;
+  job.predictions = predictions;
+  job.sums = sums;
+  job.blocks = (the_set->size()+predict_block-1)/predict_block;
+  job.next_block = 0;
+#ifdef use_threads
+  SVMINT threads = parameters->predict_threads;
+  if(threads > job.blocks) threads = job.blocks;
+  if((0 == w_linear) && (! kernel->is_reentrant())) threads = 1;
+  pthread_mutex_init(&(job.mutex),0);
+  pthread_t* pool = 0;
+  SVMINT started = 0;
+  SVMINT t;
+  if(threads > 1){
+    pool = new pthread_t[threads-1];
+    for(t=0;t<threads-1;t++){
+      if(0 != pthread_create(&(pool[t]),0,predict_worker,&job)){
+	break;
+      };
+      started++;
+    };
+  };
+  // this thread works, too
+  run_predict_job(&job);
+  for(t=0;t<started;t++){
+    pthread_join(pool[t],0);
+  };
+  if(0 != pool) delete []pool;
+  pthread_mutex_destroy(&(job.mutex));
+#else
+  run_predict_job(&job);
+#endif
+};
+
+
+void svm_c::predict(example_set_c* test_examples){
+  test_set = test_examples;
+  SVMINT i;
+  SVMFLOAT* predictions = new SVMFLOAT[test_set->size()+1];
+  predict_set(test_set,predictions,0);
   for(i=0;i<test_set->size();i++){
-    example = test_set->get_example(i);
-    prediction = predict(example);
-    test_set->put_y(i,prediction);
+    test_set->put_y(i,predictions[i]);
   };
+  delete []predictions;
   test_set->set_initialised_y();
-  test_set->put_b(examples->get_b());
+  test_set->put_b(model->b);
   if(parameters->verbosity>=4){
     cout<<"Prediction generated"<<endl;
   };
@@ -1722,23 +2241,61 @@ void svm_c::predict(example_set_c* test_examples){
 
 
 SVMFLOAT svm_c::predict(svm_example example){ 
-  SVMINT i;
-  svm_example sv;
-  SVMFLOAT the_sum=examples->get_b();
+  SVMFLOAT prediction;
+  predict_examples(&example,1,&prediction);
+  return prediction;
+};
 
-  for(i=0;i<examples_total;i++){
-    if(all_alphas[i] != 0){
-      sv = examples->get_example(i);
-      the_sum += all_alphas[i]*kernel->calculate_K(sv,example);
+
+void svm_c::predict_examples(const svm_example* x, const SVMINT count, SVMFLOAT* predictions){
+  // each batch of SVs is used for all count examples while it is in the cache
+  SVMINT i;
+  SVMINT q;
+  SVMFLOAT the_sum;
+  if(0 != w_linear){
+    for(q=0;q<count;q++){
+      the_sum = w_b;
+      for(i=0;i<x[q].length;i++){
+	if((x[q].index)[i] < w_dim){
+	  the_sum += w_linear[(x[q].index)[i]]*(x[q].att)[i];
+	};
+      };
+      predictions[q] = the_sum;
+    };
+  }
+  else{
+    kernel_query query[predict_block];
+    SVMFLOAT K_sv[predict_block*predict_batch];
+    SVMFLOAT* K_q;
+    SVMINT to;
+    SVMINT k;
+    for(q=0;q<count;q++){
+      kernel->make_query(x[q],query[q]);
+      predictions[q] = model->b;
+    };
+    for(i=0;i<model->count;i+=predict_batch){
+      to = i+predict_batch;
+      if(to > model->count) to = model->count;
+      kernel->calculate_K_rows_block(model->rows,i,to,query,count,K_sv);
+      for(q=0;q<count;q++){
+	K_q = K_sv+q*(to-i);
+	for(k=0;k<to-i;k++){
+	  predictions[q] += (model->alphas)[i+k]*K_q[k];
+	};
+      };
+    };
+    for(q=0;q<count;q++){
+      kernel->free_query(query[q]);
     };
   };
-  the_sum = examples->unscale_y(the_sum);
-  if(parameters->use_min_prediction){
-    if(the_sum < parameters->min_prediction){
-      the_sum = parameters->min_prediction;
+  for(q=0;q<count;q++){
+    predictions[q] = model->unscale_y(predictions[q]);
+    if(parameters->use_min_prediction){
+      if(predictions[q] < parameters->min_prediction){
+	predictions[q] = parameters->min_prediction;
+      };
     };
   };
-  return the_sum;
 };
 
 
@@ -1841,7 +2398,7 @@ svm_result svm_c::print_statistics(){
 
     alpha=all_alphas[i];
     if(alpha!=0){
-      norm_x = kernel->calculate_K(i,i);
+      norm_x = kernel->get_diag(i);
       if(norm_x>max_norm_x){
 	max_norm_x = norm_x;
       };
@@ -1856,7 +2413,7 @@ svm_result svm_c::print_statistics(){
     r_delta = 0;
     SVMFLOAT r_current;
     for(SVMINT j=0;j<examples_total;j++){
-      norm_x = kernel->calculate_K(j,j);
+      norm_x = kernel->get_diag(j);
       for(i=0;i<examples_total;i++){
 	r_current = norm_x-kernel->calculate_K(i,j);
 	if(r_current > r_delta){
@@ -1887,10 +2444,10 @@ svm_result svm_c::print_statistics(){
     if(parameters->loo_estim){
       if(abs(alpha)>is_zero){ 
 	if(is_alpha_neg(i)>=0){
-	  loo_loss_estim += loss(prediction-(abs(alpha)*(2*kernel->calculate_K(i,i)+r_delta)+2*epsilon_neg),y);
+	  loo_loss_estim += loss(prediction-(abs(alpha)*(2*kernel->get_diag(i)+r_delta)+2*epsilon_neg),y);
 	}
 	else{
-	  loo_loss_estim += loss(prediction+(abs(alpha)*(2*kernel->calculate_K(i,i)+r_delta)+2*epsilon_pos),y);
+	  loo_loss_estim += loss(prediction+(abs(alpha)*(2*kernel->get_diag(i)+r_delta)+2*epsilon_pos),y);
 	};
       };
     }
@@ -2062,38 +2619,16 @@ svm_result svm_c::print_statistics(){
   };
 
   SVMINT dim = examples->get_dim();
-  if(((parameters->print_w == 1) && (parameters->is_linear != 0)) ||
+  if(((parameters->print_w == 1) && (0 != w_linear)) ||
      ((dim<100) && 
       (parameters->verbosity>= 2) && 
-      (parameters->is_linear != 0))
+      (0 != w_linear))
      ){
     // print hyperplane
     SVMINT j;
-    svm_example example;
-    SVMFLOAT* w = new SVMFLOAT[dim];
-    SVMFLOAT b = examples->get_b();
-    for(j=0;j<dim;j++) w[j] = 0;
-    for(i=0;i<examples_total;i++){
-      example = examples->get_example(i);
-      alpha = examples->get_alpha(i);
-      for(j=0;j<example.length;j++){
-	w[((example.example)[j]).index] += alpha*((example.example)[j]).att;
-      };
-    };
-    if(examples->initialised_scale()){
-      SVMFLOAT* exp = examples->get_exp();
-      SVMFLOAT* var = examples->get_var();
-      for(j=0;j<dim;j++){
-	if(var[j] != 0){
-	  w[j] /= var[j];
-	};
-	if(0 != var[dim]){
-	  w[j] *= var[dim];
-	};
-	b -= w[j]*exp[j];
-      };
-      b += exp[dim];
-    };
+    hyperplane_c* the_hyperplane = get_hyperplane();
+    SVMFLOAT* w = the_hyperplane->w;
+    SVMFLOAT b = the_hyperplane->b;
     for(j=0;j<dim;j++){
       cout << "w["<<j<<"] = " << w[j] << endl;
     };
@@ -2104,7 +2639,7 @@ svm_result svm_c::print_statistics(){
     if((dim==2) && (is_pattern)){
       cout<<"x1 = "<<-w[0]/w[1]<<"*x0+"<<-b/w[1]<<endl;
     };
-    delete []w;
+    delete the_hyperplane;
   };
 
   if(parameters->verbosity>= 2){
@@ -2116,6 +2651,21 @@ svm_result svm_c::print_statistics(){
 	<<"calc ws     : "<<(time_calc/100)<<"s"<<endl
 	<<"============="<<endl
 	<<"all         : "<<(time_all/100)<<"s"<<endl;
+    if(kernel->is_dense()){
+      cout<<"Examples stored dense ("<<dense_version()<<")"<<endl;
+    };
+#ifdef use_cache_stats
+    cache_stats stats = kernel->get_cache_stats();
+    cout<<"Kernel cache:"<<endl
+	<<"accesses    : "<<stats.accesses<<endl
+	<<"hits        : "<<stats.hits<<endl
+	<<"misses      : "<<stats.misses<<endl
+	<<"evictions   : "<<stats.evictions<<endl
+	<<"rows        : "<<stats.rows_computed<<" computed, "<<(stats.time_compute_row/1e6)<<"s in get_row()"<<endl
+	<<"prefetched  : "<<stats.prefetched<<" computed in "<<(stats.time_prefetch/1e6)<<"s by the threads"<<endl
+	<<"kernel evals: "<<stats.kernel_evals<<endl
+	<<"resident    : "<<stats.bytes_resident<<" bytes (peak)"<<endl;
+#endif
   }
   else if(parameters->verbosity>=2){
     cout<<"Time for learning: "<<(time_all/100)<<"s"<<endl;
@@ -8,6 +8,64 @@
 #include "example_set.h"
 #include "globals.h"
 #include "smo.h"
+#include "model.h"
+
+// svm_c::predict evaluates the kernel for this many examples at once
+const SVMINT predict_batch = 256;
+// test sets are predicted in blocks of this many examples, each batch
+// of SVs is used for the whole block
+const SVMINT predict_block = 32;
+
+// sums of svm_c::test() over one block of test examples
+typedef struct test_sums{
+  SVMFLOAT MAE;
+  SVMFLOAT MSE;
+  SVMFLOAT loss;
+  SVMFLOAT loss_pos;
+  SVMFLOAT loss_neg;
+  SVMINT countpos;
+  SVMINT countneg;
+  SVMINT correct_pos;
+  SVMINT correct_neg;
+  SVMINT total_pos;
+  SVMINT total_neg;
+} TEST_SUMS;
+
+class svm_c;
+
+// blocks of a test set shared by the prediction threads
+typedef struct predict_job{
+  svm_c* svm;
+  example_set_c* set;
+  SVMFLOAT* predictions; // for all examples
+  test_sums* sums;       // for all blocks, 0 if only predicting
+  SVMINT blocks;
+  SVMINT next_block;
+#ifdef use_threads
+  pthread_mutex_t mutex;
+#endif
+} PREDICT_JOB;
+
+
+/**
+ * Hyperplane f(x) = w*x+b of a linear SVM in input space
+ *
+ * Is saved instead of the SVs if parameter save_w is given.
+ **/
+class hyperplane_c {
+ public:
+  SVMINT dim;
+  SVMFLOAT* w;
+  SVMFLOAT b;
+  hyperplane_c();
+  hyperplane_c(SVMINT new_dim);
+  ~hyperplane_c();
+  void init(SVMINT new_dim);
+};
+
+ostream& operator<< (ostream& data_stream, hyperplane_c& the_hyperplane);
+istream& operator>> (istream& data_stream, hyperplane_c& the_hyperplane);
+
 
 /**
  * base class for SVMs
@@ -20,6 +78,7 @@
 class svm_c {
  protected:
   smo_c smo;
+  // during training indexed by position, see kernel_c::get_active()
   SVMFLOAT* all_alphas;
   SVMFLOAT* all_ys;
 
@@ -59,6 +118,26 @@ class svm_c {
 
   SVMINT* working_set;
   SVMFLOAT* working_set_values;
+  SVMFLOAT* ws_row; // K(i,j) for j in working set
+
+  // folding for linear kernels K(x,y) = fold_a*x*y+fold_b whose rows
+  // do not fit in the cache: instead of kernel rows keep fold_w = sum_i alpha_i x_i, fold_w_sum = sum_i alpha_i
+  // and set sum_i = fold_a*fold_w*x_i+fold_b*fold_w_sum
+  int folding;
+  SVMFLOAT* fold_w;
+  SVMFLOAT fold_w_sum;
+  SVMFLOAT fold_a, fold_b;
+  void init_folding(); // fold_w from all_alphas
+  void fold_alpha(const SVMINT i, const SVMFLOAT alpha_diff);
+  void update_folded_sums(const SVMINT from, const SVMINT to);
+
+  // linear kernels predict by f(x) = w_linear*x+w_b in the scaled space
+  // instead of looping over the SVs, 0 for other kernels
+  SVMFLOAT* w_linear;
+  SVMINT w_dim;
+  SVMFLOAT w_b;
+  void collapse_w();
+  sv_model_c* model; // used by predict()
   // LOQO-parameters:
   SVMFLOAT init_margin;
   SVMFLOAT init_bound;
@@ -101,6 +180,8 @@ class svm_c {
   virtual void update_working_set();
   void put_optimizer_values();
   virtual void shrink();
+  void shrink_variable(const SVMINT i, const SVMINT last_pos);
+  void restore_example_order();
   virtual void reset_shrinked();
   virtual void project_to_constraint();
 
@@ -109,6 +190,15 @@ class svm_c {
   SVMFLOAT loss(SVMINT i); // loss of example i
   SVMFLOAT predict(svm_example example); // calculate (regression-)prediction for one example
   SVMFLOAT predict(SVMINT i); // predict example i
+  // predictions[k] = prediction of x[k], k < count <= predict_block
+  void predict_examples(const svm_example* x, const SVMINT count, SVMFLOAT* predictions);
+  void test_examples(example_set_c* the_set, const SVMINT from, const SVMINT to, const SVMFLOAT* predictions, test_sums& sums);
+  // predictions of all examples of the_set, sums of all blocks if sums != 0
+  void predict_set(example_set_c* the_set, SVMFLOAT* predictions, test_sums* sums);
+  void run_predict_job(predict_job* job);
+#ifdef use_threads
+  static void* predict_worker(void* the_job);
+#endif
   virtual void print_special_statistics();  // print statistics related to some subtype of SVM
  protected:
   virtual void init_optimizer();
@@ -134,6 +224,23 @@ class svm_c {
    * Init examples for testing or predicting
    **/
   void set_svs(example_set_c* training_examples);
+  /**
+   * Hyperplane in input space, 0 if the kernel is not linear
+   **/
+  hyperplane_c* get_hyperplane();
+  /**
+   * Predict with a saved hyperplane instead of the SVs
+   **/
+  void set_hyperplane(hyperplane_c* the_hyperplane);
+  /**
+   * Predict with a loaded model instead of the SVs, the svm deletes it
+   **/
+  void set_model(sv_model_c* the_model);
+  /**
+   * Save the SVs in binary format, see sv_model_c. Returns 0 if the
+   * file could not be written.
+   **/
+  int save_model(const char* filename);
   /*
    * print information about test set
    **/
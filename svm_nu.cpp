@@ -391,11 +391,11 @@ void svm_nu_regression_c::init_working_set(){
     SVMFLOAT new_nu_alpha = nu/((SVMFLOAT)(examples_total-examples_total%1));
 
     for(ni=0;ni<examples_total/2;ni++){
-      examples->put_alpha(ni,new_nu_alpha);
-      examples->put_alpha(examples_total-1-ni,-new_nu_alpha);
+      all_alphas[ni] = new_nu_alpha;
+      all_alphas[examples_total-1-ni] = -new_nu_alpha;
     };
     if(examples_total%2 != 0){
-      examples->put_alpha(1+examples_total/2,0);
+      all_alphas[1+examples_total/2] = 0;
     };
     examples->set_initialised_alpha();
   };
@@ -415,10 +415,7 @@ void svm_nu_regression_c::shrink(){
 	sum_alpha += all_alphas[i];
 	sum_alpha_nu += is_alpha_neg(i)*all_alphas[i];
 	last_pos--;
-	examples->swap(i,last_pos);
-	kernel->overwrite(i,last_pos);
-	sum[i] = sum[last_pos];
-	at_bound[i] = at_bound[last_pos];
+	shrink_variable(i,last_pos);
       };
     };
     
@@ -747,10 +744,10 @@ void svm_nu_pattern_c::init_working_set(){
 
     for(ni=0;ni<examples_total;ni++){
       if(is_alpha_neg(ni)> 0){
-	examples->put_alpha(ni,nu/(2*(SVMFLOAT)neg_count));
+	all_alphas[ni] = nu/(2*(SVMFLOAT)neg_count);
       }
       else{
-	examples->put_alpha(ni,-nu/(2*(SVMFLOAT)pos_count));
+	all_alphas[ni] = -nu/(2*(SVMFLOAT)pos_count);
       };
     };
     examples->set_initialised_alpha();
@@ -1068,7 +1065,7 @@ void svm_distribution_c::init_working_set(){
   };
   if(abs(the_sum-nu) > is_zero){
     for(i=0; i<examples_total;i++){
-      examples->put_alpha(i,nu/((SVMFLOAT)examples_total));
+      all_alphas[i] = nu/((SVMFLOAT)examples_total);
     };
     examples->set_initialised_alpha();
   };
@@ -1076,10 +1073,15 @@ void svm_distribution_c::init_working_set(){
   if(parameters->verbosity >= 3){
     cout<<"Initialising variables, this may take some time."<<endl;
   };
+  if(folding){
+    init_folding();
+    update_folded_sums(0,examples_total);
+  };
   for(i=0; i<examples_total;i++){
     all_ys[i] = 1;
-    sum[i] = 0;
     at_bound[i] = 0;
+    if(folding) continue;
+    sum[i] = 0;
     for(j=0; j<examples_total;j++){
       sum[i] += all_alphas[j]*kernel->calculate_K(i,j);
     };
@@ -1108,7 +1110,7 @@ void svm_distribution_c::print_special_statistics(){
     };
     if(all_alphas[i] != 0){
       svs++;
-      norm_x = kernel->calculate_K(i,i);
+      norm_x = kernel->get_diag(i);
       if(norm_x>max_norm_x){
 	max_norm_x = norm_x;
       };